@@ -0,0 +1,313 @@
+#include "arena.hpp"
+#include "bytecode.hpp"
+#include "closure.hpp"
+#include "expression.hpp"
+#include "jit.hpp"
+#include "logic.hpp"
+#include "operator.hpp"
+#include "optimize.hpp"
+#include "parser.hpp"
+#include "symbols.hpp"
+#include "ui.hpp"
+#include "variable.hpp"
+
+#include <atomic>      // for std::atomic
+#include <chrono>      // for std::chrono::steady_clock
+#include <cmath>       // for std::isnan
+#include <cstdio>      // for std::FILE, std::fopen
+#include <cstdlib>     // for std::malloc, std::free, std::strtod
+#include <iostream>    // for std::cout
+#include <new>         // for std::bad_alloc
+#include <optional>    // for std::optional
+#include <streambuf>   // for std::streambuf
+#include <string>      // for std::string
+#include <string_view> // for std::string_view
+#include <vector>      // for std::vector
+#include <fmt/format.h>
+
+#ifndef CALCULATOR_VERSION
+#define CALCULATOR_VERSION "unknown"
+#endif
+
+namespace {
+  std::atomic<std::size_t> allocations{0}; // counted by the replaced operator new below
+
+  // keep the compiler from optimizing a benchmarked result away
+  template <typename T>
+  void keep(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r"(&value) : "memory");
+#else
+    static const void* volatile sink;
+    sink = &value;
+#endif
+  }
+
+  // discards everything written to it, for the REPL output
+  class NullBuffer : public std::streambuf {
+    protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+  };
+
+  struct Case {
+    std::string name;
+    std::string text;
+  };
+
+  struct Result {
+    std::string benchmark;
+    std::string name;
+    std::size_t bytes;      // length of the expression
+    std::size_t iterations;
+    double ns_per_op;
+    double allocs_per_op;
+  };
+
+  std::vector<Case> corpus() {
+    std::vector<Case> cases = {
+      { "tiny", "1+2" },
+      { "variables", "2x^2 + 3x - 1" },
+      { "functions", "sin(x)^2 + cos(x)^2 + max(x, hypot(3, 4)) / sqrt(x + 1)" },
+    };
+
+    std::string nested = "x"; // 100 levels of parentheses
+    for (int i = 0; i < 100; i++) nested = fmt::format("({}+{})*0.5", nested, i);
+    cases.push_back({ "nested", nested });
+
+    std::string sum = "0"; // 500 terms
+    for (int i = 1; i <= 500; i++) sum += fmt::format(" + sin(x*{})/{}", i, i);
+    cases.push_back({ "long", sum });
+
+    // repeated subexpressions, with literals that fold to NaN and negative ones, for the cse benchmark
+    cases.push_back({ "shared", "max(x, sqrt(0-1)) * -2 + (x*x + 1) / (x*x + 1) + min(-0, sqrt(0-1)) + sin(x*x + 1) * -2" });
+
+    return cases;
+  }
+
+  // run `op` for at least `min_time` seconds, growing the iteration count until it does
+  template <typename F>
+  Result measure(std::string_view benchmark, const Case& c, double min_time, F&& op) {
+    using clock = std::chrono::steady_clock;
+    op(); // warm up caches, and the expression cache for the REPL path
+
+    std::size_t iterations = 1;
+    while (true) {
+      const std::size_t allocated = allocations.load(std::memory_order_relaxed);
+      const auto start = clock::now();
+      for (std::size_t i = 0; i < iterations; i++) op();
+      const double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+      const std::size_t allocs = allocations.load(std::memory_order_relaxed) - allocated;
+
+      if (elapsed >= min_time || iterations >= (std::size_t(1) << 32)) {
+        return { std::string(benchmark), c.name, c.text.size(), iterations,
+                 elapsed * 1e9 / static_cast<double>(iterations),
+                 static_cast<double>(allocs) / static_cast<double>(iterations) };
+      }
+
+      // aim a bit past min_time, at most 100 times more iterations per round
+      const double scale = elapsed > 0 ? min_time * 1.2 / elapsed : 100.0;
+      iterations = static_cast<std::size_t>(static_cast<double>(iterations) * std::clamp(scale, 2.0, 100.0));
+    }
+  }
+
+  using Outcome = sya::Result<std::optional<double>>;
+
+  // a backend's outcome against the interpreter's: the same value (NaN included), or the same error
+  bool same(const Outcome& expected, const Outcome& got) {
+    if (!expected || !got) return !expected && !got && expected.error().code == got.error().code;
+    if (!*expected || !*got) return expected->has_value() == got->has_value();
+    return **expected == **got || (std::isnan(**expected) && std::isnan(**got));
+  }
+
+  std::string describe(const Outcome& outcome) {
+    if (!outcome) return outcome.error().message();
+    return *outcome ? fmt::format("{}", **outcome) : "nothing";
+  }
+
+  // if the numbers include the cost of the :stats instrumentation
+#if defined(SYA_ENABLE_STATS)
+  constexpr bool stats_enabled = true;
+#else
+  constexpr bool stats_enabled = false;
+#endif
+
+  std::string to_json(const std::vector<Result>& results) {
+    std::string json = fmt::format("{{\n  \"version\": \"{}\",\n  \"stats\": {},\n  \"compiler\": \"{}\",\n  \"results\": [\n",
+                                   CALCULATOR_VERSION, stats_enabled,
+#if defined(__VERSION__)
+                                   __VERSION__
+#else
+                                   "unknown"
+#endif
+    );
+
+    for (std::size_t i = 0; i < results.size(); i++) {
+      const Result& r = results[i];
+      json += fmt::format(
+        "    {{ \"benchmark\": \"{}\", \"case\": \"{}\", \"bytes\": {}, \"iterations\": {}, \"ns_per_op\": {:.2f}, "
+        "\"allocs_per_op\": {:.2f}, \"ops_per_sec\": {:.0f}, \"mb_per_sec\": {:.2f} }}{}\n",
+        r.benchmark, r.name, r.bytes, r.iterations, r.ns_per_op, r.allocs_per_op,
+        1e9 / r.ns_per_op, static_cast<double>(r.bytes) * 1e3 / r.ns_per_op, i + 1 < results.size() ? "," : "");
+    }
+    return json + "  ]\n}\n";
+  }
+
+  void print_usage() {
+    fmt::print(stderr,
+      "Usage: calculator_bench [--min-time seconds] [--filter text] [--json file|-]\n"
+      "  --min-time  minimum time spent in each benchmark (default 0.2)\n"
+      "  --filter    only run benchmarks whose \"benchmark/case\" name contains text\n"
+      "  --json      also write the results as JSON to file, or to stdout instead of the table with '-'\n");
+  }
+}
+
+// count every allocation made through the global operator new
+void* operator new(std::size_t size) {
+  allocations.fetch_add(1, std::memory_order_relaxed);
+  if (void* p = std::malloc(size != 0 ? size : 1)) return p;
+  throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+
+int main(int argc, char** argv) {
+  double min_time = 0.2;
+  std::string filter;
+  std::string json_path;
+
+  for (int i = 1; i < argc; i++) {
+    std::string_view arg = argv[i];
+    if (arg == "--min-time" && i + 1 < argc) min_time = std::strtod(argv[++i], nullptr);
+    else if (arg == "--filter" && i + 1 < argc) filter = argv[++i];
+    else if (arg == "--json" && i + 1 < argc) json_path = argv[++i];
+    else {
+      print_usage();
+      return 2;
+    }
+  }
+
+  std::vector<sya::Variable> variables;
+  for (const auto& [name, value] : sya::constants) variables.push_back({ std::string(name), value });
+  variables.push_back({ "x", 1.5 });
+  sya::SymbolTable table; // for compiled programs
+  table.set("x", 1.5);
+
+  console::Interface ui;
+  NullBuffer null;
+  auto* out = std::cout.rdbuf(&null); // the REPL prints every result
+  ui.handle("x = 1.5");
+  std::cout.rdbuf(out);
+
+  std::vector<Result> results;
+  console::Table nodes({ "Case", "Nodes", "Shared nodes", "Temporaries" }); // what the cse benchmark removed
+  bool mismatch = false;
+  // every backend is checked against the interpreter before it's timed
+  auto check = [&](std::string_view benchmark, const Case& c, const Outcome& expected, const Outcome& got) {
+    if (same(expected, got)) return;
+    fmt::print(stderr, "Error: {}/{} evaluates to {} instead of {}\n", benchmark, c.name, describe(got), describe(expected));
+    mismatch = true;
+  };
+  auto selected = [&](std::string_view benchmark, const Case& c) {
+    return filter.empty() || fmt::format("{}/{}", benchmark, c.name).find(filter) != std::string::npos;
+  };
+
+  for (const Case& c : corpus()) {
+    if (selected("tokenize", c)) {
+      sya::Expression expr(c.text);
+      results.push_back(measure("tokenize", c, min_time, [&] { expr.tokenize(); keep(expr); }));
+    }
+
+    sya::Expression tokens(c.text);
+    tokens.tokenize();
+    sya::Arena arena; // transient memory, like the REPL's
+    if (selected("to_rpn", c))
+      results.push_back(measure("to_rpn", c, min_time, [&] {
+        const sya::ArenaScope scope(arena);
+        auto rpn = sya::to_rpn(tokens, arena.resource());
+        keep(rpn);
+      }));
+
+    if (selected("parse", c)) // tokenize and to_rpn fused in one pass
+      results.push_back(measure("parse", c, min_time, [&] {
+        const sya::ArenaScope scope(arena);
+        auto rpn = sya::parse(c.text, arena.resource());
+        keep(rpn);
+      }));
+
+    auto rpn = sya::to_rpn(tokens);
+    if (selected("evaluate_rpn", c))
+      results.push_back(measure("evaluate_rpn", c, min_time, [&] {
+        const sya::ArenaScope scope(arena);
+        auto r = sya::evaluate_rpn<double>(rpn, variables, arena.resource());
+        keep(r);
+      }));
+
+    auto interpreted = sya::compile<double>(rpn);
+    sya::bind(interpreted, table);
+    const Outcome expected = sya::try_evaluate(interpreted, table);
+
+    if (selected("jit", c)) { // native code, or the bytecode interpreter where it's not supported
+      auto program = sya::compile<double>(rpn);
+      sya::bind(program, table);
+      sya::BasicJitProgram<double> jit(std::move(program));
+      check("jit", c, expected, sya::try_evaluate(jit, table));
+      results.push_back(measure("jit", c, min_time, [&] { auto r = sya::try_evaluate(jit, table); keep(r); }));
+    }
+
+    if (selected("closure", c)) {
+      auto program = sya::compile<double>(rpn);
+      sya::bind(program, table);
+      sya::BasicClosureTree<double> tree(std::move(program));
+      check("closure", c, expected, sya::try_evaluate(tree, table));
+      results.push_back(measure("closure", c, min_time, [&] { auto r = sya::try_evaluate(tree, table); keep(r); }));
+    }
+
+    if (selected("cse", c)) { // constants folded first, like the REPL does, then shared
+      sya::Expression folded = rpn;
+      sya::fold_constants<double>(folded);
+      auto plain = sya::compile<double>(folded);
+      sya::bind(plain, table);
+      sya::CseStats stats;
+      auto shared = sya::compile_shared<double>(folded, &stats);
+      sya::bind(shared, table);
+
+      check("cse", c, sya::try_evaluate(plain, table), sya::try_evaluate(shared, table));
+      nodes.add_row({ c.name, fmt::to_string(stats.before), fmt::to_string(stats.after), fmt::to_string(stats.shared) });
+      results.push_back(measure("cse", c, min_time, [&] { auto r = sya::evaluate(shared, table); keep(r); }));
+    }
+
+    if (selected("repl", c)) {
+      std::cout.rdbuf(&null);
+      results.push_back(measure("repl", c, min_time, [&] { ui.handle(c.text); }));
+      ui.handle(":clear_history"); // every evaluation is kept in the history
+      std::cout.rdbuf(out);
+    }
+  }
+
+  if (json_path != "-") {
+    console::Table t({ "Benchmark", "Case", "ns/op", "allocs/op", "ops/s", "MB/s" });
+    for (const Result& r : results)
+      t.add_row({ r.benchmark, r.name, fmt::format("{:.1f}", r.ns_per_op), fmt::format("{:.2f}", r.allocs_per_op),
+                  fmt::format("{:.0f}", 1e9 / r.ns_per_op), fmt::format("{:.2f}", static_cast<double>(r.bytes) * 1e3 / r.ns_per_op) });
+    t.print();
+    if (nodes.row_count() > 0) nodes.print();
+    if (stats_enabled) fmt::print("Built with CALCULATOR_ENABLE_STATS, the timings include the instrumentation.\n");
+  }
+
+  if (!json_path.empty()) {
+    const std::string json = to_json(results);
+    if (json_path == "-") fmt::print("{}", json);
+    else {
+      std::FILE* file = std::fopen(json_path.c_str(), "w");
+      if (!file) {
+        fmt::print(stderr, "Error: Cannot open file: '{}'\n", json_path);
+        return 1;
+      }
+      std::fputs(json.c_str(), file);
+      std::fclose(file);
+    }
+  }
+
+  return mismatch ? 1 : 0;
+}
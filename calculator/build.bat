@@ -18,7 +18,7 @@ echo %CYAN% => Building project...
 if not exist "%OUT_DIR%" mkdir "%OUT_DIR%"
 cd "%OUT_DIR%" || exit /b 1
 
-cmake ..
+cmake .. -DCALCULATOR_ENABLE_STATS=ON
 if errorlevel 1 goto build_failed
 
 cmake --build .
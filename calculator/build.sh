@@ -22,7 +22,7 @@ build_cmake() {
   mkdir -p "./$OUT_DIR"
   cd "./$OUT_DIR"
 
-  cmake ..
+  cmake .. -DCALCULATOR_ENABLE_STATS=ON # the interactive build ships :stats
   cmake --build .
 
   cd ..
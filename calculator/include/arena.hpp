@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstddef>         // for std::size_t, std::byte
+#include <memory>          // for std::unique_ptr
+#include <memory_resource> // for std::pmr::memory_resource, std::pmr::monotonic_buffer_resource
+#include <optional>        // for std::optional
+
+namespace sya {
+  /**
+   * @brief A reusable bump allocator for the transient memory of one evaluation (tokens, RPN, operator
+   * and evaluation stacks). Allocations bump a pointer into one buffer and are never freed one by one,
+   * reset() rewinds the buffer in O(1). When an evaluation needs more than the buffer it overflows to
+   * the heap, and the next reset() grows the buffer to fit, so a steady workload stops allocating at all.
+   */
+  class Arena {
+    private:
+    // forwards to the heap, counting what the arena had to take from it
+    class Overflow : public std::pmr::memory_resource {
+      public:
+      std::size_t bytes = 0;
+
+      private:
+      void* do_allocate(std::size_t size, std::size_t align) override;
+      void do_deallocate(void* p, std::size_t size, std::size_t align) override;
+      bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+    };
+
+    std::unique_ptr<std::byte[]> m_buffer;
+    std::size_t m_size;
+    Overflow m_overflow;
+    std::optional<std::pmr::monotonic_buffer_resource> m_resource; // rebuilt over the buffer when it grows
+
+    public:
+    static constexpr std::size_t default_size = 16 * 1024;
+
+    /************************\
+    |      CONSTRUCTORS      |
+    \************************/
+    explicit Arena(std::size_t size = default_size);
+
+    Arena(const Arena&) = delete; // containers hold pointers to its resource
+    Arena& operator=(const Arena&) = delete;
+
+    /************************\
+    |         METHODS        |
+    \************************/
+    [[nodiscard]] std::pmr::memory_resource* resource() noexcept { return &*m_resource; }
+    [[nodiscard]] std::size_t capacity() const noexcept { return m_size; } // bytes served without touching the heap
+
+    // free everything allocated since the last reset, every object allocated from it must be gone
+    void reset() noexcept;
+  };
+
+  // resets an arena when leaving a scope, declare it before the containers using the arena
+  class ArenaScope {
+    private:
+    Arena& m_arena;
+
+    public:
+    explicit ArenaScope(Arena& arena) noexcept : m_arena(arena) {}
+    ~ArenaScope() { m_arena.reset(); }
+    ArenaScope(const ArenaScope&) = delete;
+    ArenaScope& operator=(const ArenaScope&) = delete;
+  };
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstddef>     // for std::size_t
+#include <cstdio>      // for std::FILE
+#include <memory>      // for std::unique_ptr
+#include <string>      // for std::string
+#include <string_view> // for std::string_view
+#include <vector>      // for std::vector
+#include <fmt/format.h>
+
+#include "cache.hpp"
+#include "symbols.hpp"
+#include "thread_pool.hpp"
+
+namespace console {
+  // what to do with a line that fails to evaluate
+  enum class ErrorPolicy { SKIP, EMIT, ABORT };
+
+  struct BatchSummary {
+    std::size_t lines = 0;   // non-blank lines read
+    std::size_t results = 0; // results written
+    std::size_t errors = 0;
+    bool aborted = false;
+  };
+
+  /**
+   * @brief Non-interactive evaluation of one expression per line, without prompts. Results are written one per
+   * line through a buffer flushed in large blocks, assignments write nothing and persist across lines.
+   * Files are memory-mapped where supported, streams are read in large blocks. A line is compiled for one
+   * evaluation the first time it's seen, and kept in the expression cache only once it comes back.
+   *
+   * With more than one job, the lines between two assignments are independent: they are split into chunks
+   * evaluated on a work-stealing pool, each worker with its own copy of the variables, and written in input
+   * order. Assignment lines are evaluated alone, in order, once every line before them is done.
+   */
+  class BatchRunner {
+    private:
+    struct Context { // what evaluating a line needs, one per thread
+      sya::SymbolTable variables;
+      sya::BasicExpressionCache<double> cache; // lines seen more than once
+      std::vector<std::size_t> seen = std::vector<std::size_t>(1 << 16); // hashes of lines seen once, by their low bits
+      std::size_t version = 0; // version of the shared variables copied into `variables`
+    };
+
+    struct Line {
+      std::string_view text;
+      std::size_t number; // 1-based line number in the input
+    };
+
+    struct Chunk {
+      std::size_t begin, end; // range of m_window
+      fmt::memory_buffer out;
+      BatchSummary summary;
+      std::string error; // set if the chunk stopped on an error, under the abort policy
+    };
+
+    Context m_main; // the shared variables, only written by assignment lines
+    std::size_t m_version = 0; // bumped by every assignment line, so workers know to copy the variables again
+    std::vector<std::unique_ptr<Context>> m_workers;
+    std::unique_ptr<sya::ThreadPool> m_pool; // null when running on a single thread
+
+    std::vector<Line> m_window; // complete lines waiting to be evaluated in parallel
+    std::vector<Chunk> m_chunks;
+    std::size_t m_number = 0; // number of the last line read
+
+    fmt::memory_buffer m_out;
+    std::FILE* m_sink;
+    ErrorPolicy m_policy;
+    BatchSummary m_summary;
+
+    // evaluate one line in ctx, false if it must stop the batch (with the message in `error`)
+    bool evaluate(Context& ctx, Line line, fmt::memory_buffer& out, BatchSummary& summary, std::string& error);
+    bool stop(const std::string& error); // flush and report an aborting error, always false
+
+    bool lines(std::string_view text); // evaluate every line of text, false to stop
+    bool run_window(); // evaluate the lines of m_window, false to stop
+    bool run_segment(std::size_t begin, std::size_t end); // evaluate independent lines of m_window in parallel
+    void sync(Context& ctx); // copy the shared variables into a worker's context
+    void flush();
+
+    public:
+    /************************\
+    |      CONSTRUCTORS      |
+    \************************/
+    // jobs is the number of threads, 0 for one per hardware thread
+    explicit BatchRunner(ErrorPolicy policy = ErrorPolicy::EMIT, std::size_t jobs = 1, std::FILE* sink = stdout);
+    BatchRunner(const BatchRunner&) = delete;
+    BatchRunner& operator=(const BatchRunner&) = delete;
+
+    /************************\
+    |         METHODS        |
+    \************************/
+    BatchSummary run_file(const std::string& path); // throws std::runtime_error if the file can't be read
+    BatchSummary run_stream(std::FILE* source);
+  };
+}
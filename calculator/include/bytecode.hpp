@@ -0,0 +1,105 @@
+#pragma once
+
+#include "error.hpp"
+#include "expression.hpp"
+#include "operator.hpp"
+#include "symbols.hpp"
+#include "variable.hpp"
+
+#include <cstdint>  // for std::uint8_t, std::uint32_t
+#include <optional> // for std::optional
+#include <span>     // for std::span
+#include <stdexcept> // for std::logic_error
+#include <string>   // for std::string
+#include <vector>   // for std::vector
+
+namespace sya {
+  /**
+   * @brief Opcodes of a compiled program, every operand is already decoded at compile time.
+   */
+  enum class OpCode : uint8_t {
+    PUSH,  // push literals[arg]
+    LOAD,  // push the value of variable slot arg
+    STORE, // assign the top of the stack to variable slot arg (the value stays on the stack)
+    ADD, SUB, MUL, DIV, POW,
+    CALL,  // call functions[arg] with the top `arity` values of the stack
+    SAVE,  // keep the top of the stack in temporary arg (the value stays on the stack)
+    RECALL, // push the value of temporary arg
+  };
+
+  struct Instruction {
+    OpCode op;
+    uint8_t arity; // argument count (CALL only)
+    uint32_t arg;  // literal, variable slot, function or temporary index depending on op
+  };
+
+  /**
+   * @brief A flat, contiguous form of an RPN expression that can be evaluated with no string work.
+   * Variables are referred to by slot, names[slot] keeps the name each slot was compiled from.
+   * Once bound to a SymbolTable, LOAD/STORE operands are table slots and symbols[slot] maps each
+   * program slot to its table slot.
+   * T is the scalar type literals are decoded to and the program is evaluated in.
+   */
+  template <typename T>
+  struct BasicProgram {
+    std::vector<Instruction> code;
+    std::vector<T> literals;               // pre-decoded numeric literals
+    std::vector<FunctionPtr<T>> functions; // resolved math routines
+    std::vector<Function> calls;           // function behind each routine, for the domain checks of try_evaluate()
+    std::vector<std::string> names;        // variable name of each slot
+    std::vector<uint32_t> positions;       // 1-based source position of each slot's first use, 0 if unknown
+    std::vector<bool> inputs;              // slots read before being assigned
+    std::vector<bool> outputs;             // slots assigned
+    std::vector<std::size_t> symbols;      // symbol table slot of each slot, empty until bound
+    std::size_t depth = 0;                 // maximum evaluation stack depth
+    std::size_t temps = 0;                 // number of temporaries (shared subexpressions)
+    bool assigns = false;                  // if the program assigns any variable
+  };
+
+  using Program = BasicProgram<float>;
+
+  // explicitly instantiated for float, double and long double in bytecode.cpp
+  // the try_ functions return their errors, the others are thin wrappers throwing them
+  template <typename T = float>
+  [[nodiscard]] Result<BasicProgram<T>> try_compile(const Expression& rpn_expr);
+  template <typename T = float>
+  [[nodiscard]] BasicProgram<T> compile(const Expression& rpn_expr); // compile the output of to_rpn()
+
+  // run a compiled program over a dense array of slot values (one per program slot)
+  template <typename T>
+  [[nodiscard]] Result<std::optional<T>> try_evaluate(const BasicProgram<T>& program, std::span<double> slots);
+  template <typename T>
+  [[nodiscard]] std::optional<T> evaluate(const BasicProgram<T>& program, std::span<double> slots);
+  // bind the program slots to named variables, run it and write assigned values back
+  template <typename T>
+  [[nodiscard]] std::optional<T> evaluate(const BasicProgram<T>& program, std::vector<Variable>& variables);
+
+  // intern the program's variables in a symbol table once, and relocate its operands to the table slots
+  template <typename T>
+  void bind(BasicProgram<T>& program, SymbolTable& table);
+  // run a program bound to `table` directly over the table's values
+  template <typename T>
+  [[nodiscard]] Result<std::optional<T>> try_evaluate(const BasicProgram<T>& program, SymbolTable& table);
+  template <typename T>
+  [[nodiscard]] std::optional<T> evaluate(const BasicProgram<T>& program, SymbolTable& table);
+
+  // the table side of every backend's try_evaluate(): undefined inputs are reported before `run(slots)`
+  // runs the program (however it was translated) over the table's values, and assigned slots defined after
+  template <typename T, typename Run>
+  [[nodiscard]] Result<std::optional<T>> evaluate_bound(const BasicProgram<T>& program, SymbolTable& table, Run&& run) {
+    // a misuse of the API rather than an invalid expression, still thrown
+    if (program.symbols.size() != program.names.size()) throw std::logic_error("Invalid program: program is not bound to a symbol table");
+
+    for (std::size_t s = 0; s < program.names.size(); s++) // a flag check per variable, no name lookup
+      if (program.inputs[s] && !table.defined(program.symbols[s]))
+        return std::unexpected(Error{ErrorCode::UNDEFINED_VARIABLE, s < program.positions.size() ? program.positions[s] : 0,
+                                     program.names[s]});
+
+    Result<std::optional<T>> result = run(table.values());
+
+    if (result && program.assigns)
+      for (std::size_t s = 0; s < program.names.size(); s++)
+        if (program.outputs[s]) table.define(program.symbols[s]);
+    return result;
+  }
+}
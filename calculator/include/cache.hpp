@@ -0,0 +1,85 @@
+#pragma once
+
+#include "bytecode.hpp"
+#include "error.hpp"
+#include "expression.hpp"
+#include "symbols.hpp"
+
+#include <list>          // for std::list
+#include <string>        // for std::string
+#include <string_view>   // for std::string_view
+#include <unordered_map> // for std::unordered_map
+#include <utility>       // for std::pair
+#include <vector>        // for std::vector
+
+namespace sya {
+  /**
+   * @brief An expression ready to evaluate: its RPN form and the program compiled (and bound) from it.
+   */
+  template <typename T>
+  struct CompiledExpression {
+    Expression rpn;
+    BasicProgram<T> program;
+  };
+
+  struct CacheStats {
+    std::size_t hits = 0;
+    std::size_t misses = 0;
+    std::size_t evictions = 0;
+    std::size_t entries = 0;
+    std::size_t bytes = 0; // estimated memory held by the cached entries
+  };
+
+  /**
+   * @brief A bounded LRU cache from expression text to its compiled form, so that evaluating the same text
+   * again skips parse() and compile(). Bounded by entry count and by (estimated) bytes.
+   * Programs are bound to the symbol table given to get(), the cache is dropped if another table is used.
+   */
+  template <typename T>
+  class BasicExpressionCache {
+    private:
+    struct Entry {
+      std::string key;
+      CompiledExpression<T> value;
+      std::size_t bytes;
+    };
+
+    std::list<Entry> m_entries; // most recently used first
+    std::unordered_map<std::string_view, typename std::list<Entry>::iterator> m_index; // keys view the entries' keys
+    const SymbolTable* m_table = nullptr; // table the cached programs are bound to
+    std::size_t m_max_entries;
+    std::size_t m_max_bytes;
+    CacheStats m_stats;
+
+    void evict(); // drop least recently used entries until the cache fits its limits
+
+    public:
+    /************************\
+    |      CONSTRUCTORS      |
+    \************************/
+    explicit BasicExpressionCache(std::size_t max_entries = 1024, std::size_t max_bytes = 1 << 20) noexcept
+      : m_max_entries(max_entries), m_max_bytes(max_bytes) {}
+    BasicExpressionCache(const BasicExpressionCache&) = delete; // index keys view the cache's own entries
+    BasicExpressionCache& operator=(const BasicExpressionCache&) = delete;
+
+    /************************\
+    |         METHODS        |
+    \************************/
+    // return the compiled form of `expr`, compiling and binding it to `table` on a miss,
+    // the reference stays valid until the next call. Invalid expressions are not cached,
+    // try_get() returns their error (viewing `expr`), get() throws it.
+    [[nodiscard]] Result<const CompiledExpression<T>*> try_get(std::string_view expr, SymbolTable& table);
+    const CompiledExpression<T>& get(std::string_view expr, SymbolTable& table);
+
+    // add an expression compiled and bound to `table` elsewhere (like a snapshot) as the most recently used,
+    // unless it's already cached
+    void insert(std::string_view expr, CompiledExpression<T> value, const SymbolTable& table);
+    // the cached entries, least recently used first, valid until the cache is modified
+    [[nodiscard]] std::vector<std::pair<std::string_view, const CompiledExpression<T>*>> entries() const;
+
+    void set_limits(std::size_t max_entries, std::size_t max_bytes);
+    void clear() noexcept; // drop every entry, counters are kept
+    void reset_stats() noexcept;
+    [[nodiscard]] CacheStats stats() const noexcept;
+  };
+}
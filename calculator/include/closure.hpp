@@ -0,0 +1,84 @@
+#pragma once
+
+#include "bytecode.hpp"
+#include "expression.hpp"
+#include "symbols.hpp"
+
+#include <cstddef>  // for std::size_t
+#include <cstdint>  // for std::uint32_t
+#include <optional> // for std::optional
+#include <span>     // for std::span
+#include <vector>   // for std::vector
+
+namespace sya {
+  /**
+   * @brief A compiled program rebuilt as a tree of pre-bound nodes: each node holds the routine evaluating it,
+   * direct pointers to its children and its decoded operand (literal, slot or resolved math function).
+   * Common leaf patterns (variable op literal, literal op variable) get dedicated routines.
+   * Portable alternative to the JIT, needing no executable memory. Trees deeper than max_depth are
+   * interpreted instead, so that evaluation never recurses deeper than that.
+   */
+  template <typename T>
+  class BasicClosureTree {
+    public:
+    static constexpr std::size_t max_depth = 2048;
+
+    struct Context {
+      double* slots;
+      T* temps;
+      std::optional<ErrorCode>* error; // the first failure, the routines left after it do nothing
+    };
+
+    struct Node;
+    using Eval = T (*)(const Node& node, const Context& ctx);
+
+    struct Node {
+      Eval eval;
+      const Node* left = nullptr;  // first child
+      const Node* right = nullptr; // second child
+      T value{};                   // literal operand
+      std::uint32_t index = 0;     // variable slot or temporary
+      FunctionPtr<T> fn = nullptr;
+      Function call{};             // function behind fn, for its domain check
+    };
+
+    private:
+    BasicProgram<T> m_program; // kept for its metadata, and interpreted when there is no tree
+    std::vector<Node> m_nodes; // never reallocated once built, nodes point into it
+    std::vector<const Node*> m_roots; // values left on the stack, evaluated in order
+
+    public:
+    /************************\
+    |      CONSTRUCTORS      |
+    \************************/
+    explicit BasicClosureTree(BasicProgram<T> program);
+
+    BasicClosureTree(const BasicClosureTree&) = delete; // nodes point into m_nodes
+    BasicClosureTree& operator=(const BasicClosureTree&) = delete;
+    BasicClosureTree(BasicClosureTree&&) noexcept = default; // moving keeps the node buffer
+    BasicClosureTree& operator=(BasicClosureTree&&) noexcept = default;
+
+    /************************\
+    |         METHODS        |
+    \************************/
+    [[nodiscard]] bool tree() const noexcept { return !m_roots.empty(); } // false if it falls back to the interpreter
+    [[nodiscard]] const BasicProgram<T>& program() const noexcept { return m_program; }
+
+    // same contract as try_evaluate(const BasicProgram<T>&, std::span<double>), and evaluate() throwing its error
+    [[nodiscard]] Result<std::optional<T>> try_evaluate(std::span<double> slots) const;
+    [[nodiscard]] std::optional<T> evaluate(std::span<double> slots) const;
+  };
+
+  using ClosureTree = BasicClosureTree<float>;
+
+  // compile the output of to_rpn() and build its tree, explicitly instantiated for float, double and long double in closure.cpp
+  template <typename T = float>
+  [[nodiscard]] BasicClosureTree<T> closure_compile(const Expression& rpn_expr);
+
+  // run a tree bound to `table` directly over the table's values, like try_evaluate() and evaluate()
+  // over a bound BasicProgram. Explicitly instantiated for float, double and long double in closure.cpp
+  template <typename T>
+  [[nodiscard]] Result<std::optional<T>> try_evaluate(const BasicClosureTree<T>& tree, SymbolTable& table);
+  template <typename T>
+  [[nodiscard]] std::optional<T> evaluate(const BasicClosureTree<T>& tree, SymbolTable& table);
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "arena.hpp"
+#include "bytecode.hpp"
+#include "error.hpp"
+#include "operator.hpp"
+#include "reduce.hpp"
+#include "symbols.hpp"
+#include "variable.hpp"
+
+#include <optional>    // for std::optional
+#include <span>        // for std::span
+#include <string_view> // for std::string_view
+#include <vector>      // for std::vector
+
+namespace sya {
+  /**
+   * @brief Buffers an evaluating thread reuses from one expression to the next: everything transient
+   * (the RPN, the parser's stacks) comes from the arena, reset after each expression.
+   * One per thread: thread_scratch() gives the calling thread's.
+   */
+  struct Scratch {
+    Arena arena; // transient memory of one expression
+  };
+
+  [[nodiscard]] Scratch& thread_scratch() noexcept;
+
+  /**
+   * @brief The registries of the language (functions, operators and constants) and the entry points
+   * of the pipeline. An Engine never changes once built: it's shared by every thread with no locking,
+   * and all mutable state lives in the caller's Scratch, SymbolTable and programs.
+   */
+  class Engine {
+    private:
+    std::span<const FunctionDef> m_functions;
+    std::span<const Constant> m_constants;
+    std::span<const ReductionDef> m_reductions;
+
+    public:
+    /************************\
+    |      CONSTRUCTORS      |
+    \************************/
+    constexpr Engine() noexcept : m_functions(sya::functions), m_constants(sya::constants), m_reductions(sya::reductions) {} // the built-in registries
+
+    [[nodiscard]] static const Engine& shared() noexcept; // the process-wide engine
+
+    /************************\
+    |         METHODS        |
+    \************************/
+    [[nodiscard]] constexpr std::span<const FunctionDef> functions() const noexcept { return m_functions; }
+    [[nodiscard]] constexpr std::span<const Constant> constants() const noexcept { return m_constants; }
+    [[nodiscard]] constexpr std::span<const ReductionDef> reductions() const noexcept { return m_reductions; }
+
+    [[nodiscard]] constexpr const FunctionDef* function(std::string_view name) const noexcept { return sya::find_function(name); }
+    [[nodiscard]] constexpr const Constant* constant(std::string_view name) const noexcept { return sya::find_constant(name); }
+    [[nodiscard]] constexpr const ReductionDef* reduction(std::string_view name) const noexcept { return sya::find_reduction(name); }
+    [[nodiscard]] constexpr bool is_operator(char op) const noexcept { return sya::is_operator(op); }
+    [[nodiscard]] constexpr OperatorPrec precedence(std::string_view op) const noexcept { return opprec(op); }
+
+    // parse, fold and compile an expression in the scratch arena,
+    // explicitly instantiated for float, double and long double in engine.cpp
+    // the try_ versions return the errors of invalid expressions (viewing `expr`), the others throw them
+    template <typename T = float>
+    [[nodiscard]] Result<BasicProgram<T>> try_compile(std::string_view expr, Scratch& scratch = thread_scratch()) const;
+    template <typename T = float>
+    [[nodiscard]] BasicProgram<T> compile(std::string_view expr, Scratch& scratch = thread_scratch()) const;
+
+    // compile an expression, bind it to `table` and evaluate it there
+    template <typename T = float>
+    [[nodiscard]] Result<std::optional<T>> try_evaluate(std::string_view expr, SymbolTable& table, Scratch& scratch = thread_scratch()) const;
+    template <typename T = float>
+    std::optional<T> evaluate(std::string_view expr, SymbolTable& table, Scratch& scratch = thread_scratch()) const;
+  };
+}
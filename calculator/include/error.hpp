@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>     // for std::uint8_t, std::uint16_t, std::uint32_t
+#include <expected>    // for std::expected, std::unexpected
+#include <string>      // for std::string
+#include <string_view> // for std::string_view
+
+namespace sya {
+  /**
+   * @brief Everything that can make an expression fail, from lexing to evaluation.
+   */
+  enum class ErrorCode : uint8_t {
+    // lexing
+    EMPTY_EXPRESSION, INVALID_CHARACTER, WHITESPACE_IN_NUMBER, MULTIPLE_DECIMAL_POINTS,
+    EMPTY_PARENTHESES, UNEXPECTED_CLOSING_PARENT, MISSING_CLOSING_PARENT, UNEXPECTED_AFTER_UNARY,
+    DOUBLE_UNARY, DOUBLE_OPERATOR, MISPLACED_SEPARATOR, ASSIGNMENT_TO_VALUE, ASSIGNMENT_TO_FUNCTION,
+    ASSIGNMENT_TO_CONSTANT,
+    // parsing
+    OPERATOR_AT_BOUNDARY, MISSING_OPERAND, TOO_MANY_OPERANDS, SEPARATOR_OUTSIDE_FUNCTION,
+    MISMATCHED_PARENTHESES, ARGUMENT_COUNT, INVALID_TOKEN, INVALID_ASSIGNMENT,
+    // compiling
+    MISSING_ARGUMENTS, MISSING_ASSIGNED_VALUE, INVALID_OPERATOR, INVALID_FUNCTION,
+    NUMBER_OUT_OF_RANGE, INVALID_NUMBER,
+    // evaluating
+    UNDEFINED_VARIABLE, DIVISION_BY_ZERO, LOG_DOMAIN, ACOSH_DOMAIN, ATANH_DOMAIN,
+  };
+
+  /**
+   * @brief A failure as a compact code and where it happened, its message is only formatted by message(),
+   * when it's displayed. `text` views the source expression (or the program) the error was raised for,
+   * which must outlive the error.
+   */
+  struct Error {
+    ErrorCode code;
+    uint32_t position = 0;        // 1-based position in the source expression, 0 if unknown
+    std::string_view text = {};   // character, number, function or variable the error is about
+    uint16_t expected = 0, got = 0; // argument counts, or missing parentheses in `got`
+
+    [[nodiscard]] std::string message() const; // the text the throwing API puts in its exceptions
+  };
+
+  template <typename T>
+  using Result = std::expected<T, Error>;
+
+  [[noreturn]] void raise(const Error& error); // throw the exception the throwing API raises for `error`
+
+  // make an error raised over a copy of `source` (like the tokens of its RPN form) view `source` instead,
+  // at the position it was raised at, so that it outlives the copy. Its text is dropped if it isn't found there.
+  [[nodiscard]] Error locate(Error error, std::string_view source) noexcept;
+}
@@ -4,7 +4,7 @@
 #include "utils.hpp"
 #include "variable.hpp"
 
-#include <deque> // for std::deque
+#include <memory_resource> // for std::pmr::vector, std::pmr::memory_resource
 #include <string_view> // for std::string_view
 #include <optional>
 
@@ -14,12 +14,12 @@ namespace sya {
    */
   class Expression { // deriving from ItClasses to make it iterable
     private:
-    using t = std::deque<Token>; // to make things clean
+    using t = std::pmr::vector<Token>; // contiguous, reusing its capacity across tokenize() calls, and allocated from an arena if given one
     using it = decltype(std::begin(std::declval<t&>()));
     using cit = decltype(std::cbegin(std::declval<t&>()));
 
     std::string m_expr; // the string given expression
-    t m_tokens; // the tokenized expression as a std::deque<Token>
+    t m_tokens; // the tokenized expression as a std::vector<Token>
 
     public:
     /************************\
@@ -27,7 +27,9 @@ namespace sya {
     \************************/
     Expression() noexcept = default; // default ctor
     Expression(std::string_view expr);
-    Expression(const Expression& expr) = default; // copying
+    explicit Expression(std::pmr::memory_resource* resource) noexcept; // tokens allocated from `resource`
+    Expression(std::string_view expr, std::pmr::memory_resource* resource);
+    Expression(const Expression& expr) = default; // copying, the copy allocates from the default resource
     Expression(Expression&& expr) noexcept = default; // moving
 
     /************************\
@@ -53,16 +55,18 @@ namespace sya {
 
     [[nodiscard]] const std::string& expression() const noexcept; // return string expression
     void set_expression(std::string_view expr);
-    [[nodiscard]] t tokens() const noexcept; // return tokens
+    [[nodiscard]] const t& tokens() const noexcept; // return tokens
 
+    void reserve(std::size_t n); // reserve room for n tokens
     void push(Token token); // push a new token to the expression (tokens)
+    void push(std::string_view value, TokenType type, uint32_t position = 0); // build a new token in place at the end of the expression
     void pop(); // pop from expression
     [[nodiscard]] std::optional<Token> first() const; // return first token in the expression
     [[nodiscard]] std::optional<Token> last() const; // return last token in the expresion
-    [[nodiscard]] std::string first_v() const; // return first token in the expression
-    [[nodiscard]] std::string last_v() const; // return last token in the expresion
-    [[nodiscard]] TokenType first_t() const; // return first token in the expression
-    [[nodiscard]] TokenType last_t() const; // return last token in the expresion
+    [[nodiscard]] std::string_view first_v() const noexcept; // return first token in the expression
+    [[nodiscard]] std::string_view last_v() const noexcept; // return last token in the expresion
+    [[nodiscard]] TokenType first_t() const noexcept; // return first token in the expression
+    [[nodiscard]] TokenType last_t() const noexcept; // return last token in the expresion
 
     void clear() noexcept; // clear string expression and tokens as well
     [[nodiscard]] bool empty() const noexcept; // if expression is empty
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "bytecode.hpp"
+#include "expression.hpp"
+#include "variable.hpp"
+
+#include <span>        // for std::span
+#include <string_view> // for std::string_view
+#include <vector>      // for std::vector
+
+namespace sya {
+  /**
+   * @brief The value of an expression and its partial derivatives, partials[i] is the derivative
+   * with respect to the i-th variable it was differentiated with respect to.
+   */
+  template <typename T>
+  struct BasicGradient {
+    T value{};
+    std::vector<T> partials;
+  };
+
+  using Gradient = BasicGradient<float>;
+
+  // forward-mode differentiation: the program is run once over dual numbers, every stack entry is a row
+  // holding its value followed by one tangent per variable of `wrt`, so that each operation updates all
+  // the tangents in one element-wise loop. Variables are read from `variables`, a name of `wrt` the
+  // expression doesn't use gets a zero partial. Explicitly instantiated in gradient.cpp, like evaluate_batch()
+  template <typename T>
+  [[nodiscard]] BasicGradient<T> evaluate_gradient(const Expression& rpn_expr, std::span<const std::string_view> wrt,
+                                                   const std::vector<Variable>& variables);
+  template <typename T>
+  [[nodiscard]] BasicGradient<T> evaluate_gradient(const BasicProgram<T>& program, std::span<const std::string_view> wrt,
+                                                   const std::vector<Variable>& variables);
+}
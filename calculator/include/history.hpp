@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstddef>       // for std::size_t
+#include <cstdint>       // for std::uint32_t
+#include <deque>         // for std::deque
+#include <string>        // for std::string
+#include <string_view>   // for std::string_view
+#include <unordered_map> // for std::unordered_map
+#include <vector>        // for std::vector
+
+namespace console {
+  // an entry of the history, its expression views the store and is valid until the store is modified
+  struct HistoryEntry {
+    std::size_t id;
+    std::string_view expression;
+    double result;
+  };
+
+  /**
+   * @brief The history of a session, bounded by (estimated) bytes: the oldest entries are dropped once it's full.
+   * Entries are kept in a ring buffer as an id, an interned expression and the result as a number, so that an
+   * expression evaluated many times is stored once. Searches scan the distinct expressions, not the entries.
+   */
+  class HistoryStore {
+    private:
+    struct Record {
+      std::size_t id;
+      uint32_t text; // index of the interned expression
+      double result;
+    };
+
+    std::vector<Record> m_ring; // capacity is a power of two, grown while the byte limit allows
+    std::size_t m_first = 0;    // index of the oldest record in m_ring
+    std::size_t m_count = 0;
+
+    std::deque<std::string> m_texts;   // interned expressions (a deque, so that index keys stay valid)
+    std::vector<uint32_t> m_refs;      // records using each text, 0 for a free text
+    std::vector<uint32_t> m_free;      // free texts, reused first
+    std::unordered_map<std::string_view, uint32_t> m_index; // expression -> text
+
+    std::size_t m_next = 1; // id of the next entry, ids keep growing when old entries are dropped
+    std::size_t m_bytes = 0;
+    std::size_t m_max_bytes;
+
+    uint32_t intern(std::string_view expression);
+    void release(uint32_t text);
+    void pop(); // drop the oldest entry
+    void evict(); // drop the oldest entries until the store fits its limit
+
+    [[nodiscard]] const Record& record(std::size_t i) const noexcept { return m_ring[(m_first + i) & (m_ring.size() - 1)]; }
+
+    public:
+    /************************\
+    |      CONSTRUCTORS      |
+    \************************/
+    explicit HistoryStore(std::size_t max_bytes = 16 << 20) noexcept : m_max_bytes(max_bytes) {}
+    HistoryStore(const HistoryStore&) = delete; // index keys view the store's own texts
+    HistoryStore(HistoryStore&&) noexcept = default;
+
+    HistoryStore& operator=(const HistoryStore&) = delete;
+    HistoryStore& operator=(HistoryStore&&) noexcept = default;
+
+    /************************\
+    |         METHODS        |
+    \************************/
+    std::size_t add(std::string_view expression, double result); // append an entry, returns its id
+    void add(std::size_t id, std::string_view expression, double result); // append an entry with a given id, like a saved one
+
+    [[nodiscard]] HistoryEntry operator[](std::size_t i) const noexcept; // i-th entry, from the oldest
+    [[nodiscard]] std::size_t size() const noexcept { return m_count; }
+    [[nodiscard]] bool empty() const noexcept { return m_count == 0; }
+
+    [[nodiscard]] std::vector<HistoryEntry> last(std::size_t n) const; // the n most recent entries, oldest first
+    [[nodiscard]] std::vector<HistoryEntry> grep(std::string_view pattern) const; // entries whose expression contains pattern
+
+    void set_limit(std::size_t max_bytes);
+    [[nodiscard]] std::size_t limit() const noexcept { return m_max_bytes; }
+    [[nodiscard]] std::size_t bytes() const noexcept { return m_bytes; } // estimated memory held by the entries
+    void clear() noexcept;
+  };
+}
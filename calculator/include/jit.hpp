@@ -0,0 +1,63 @@
+#pragma once
+
+#include "bytecode.hpp"
+#include "expression.hpp"
+#include "symbols.hpp"
+
+#include <cstddef>  // for std::size_t
+#include <optional> // for std::optional
+#include <span>     // for std::span
+
+namespace sya {
+  /**
+   * @brief A compiled program translated to native x86-64 code (scalar SSE2) in an executable buffer.
+   * Variables are read from and written to the slot array, the evaluation stack lives in memory at offsets
+   * resolved at translation time, and functions are called through their math routines.
+   * Where native code isn't supported (long double, other architectures or ABIs, or if the buffer can't be
+   * mapped) the program is interpreted instead, with the same results and errors.
+   */
+  template <typename T>
+  class BasicJitProgram {
+    private:
+    BasicProgram<T> m_program; // kept for its metadata, and interpreted when there is no native code
+    void* m_code = nullptr;    // executable buffer
+    std::size_t m_size = 0;
+
+    void release() noexcept;
+
+    public:
+    /************************\
+    |      CONSTRUCTORS      |
+    \************************/
+    explicit BasicJitProgram(BasicProgram<T> program);
+    ~BasicJitProgram() { release(); }
+
+    BasicJitProgram(const BasicJitProgram&) = delete; // owns its buffer
+    BasicJitProgram& operator=(const BasicJitProgram&) = delete;
+    BasicJitProgram(BasicJitProgram&& other) noexcept;
+    BasicJitProgram& operator=(BasicJitProgram&& other) noexcept;
+
+    /************************\
+    |         METHODS        |
+    \************************/
+    [[nodiscard]] bool native() const noexcept { return m_code != nullptr; } // false if it falls back to the interpreter
+    [[nodiscard]] const BasicProgram<T>& program() const noexcept { return m_program; }
+
+    // same contract as try_evaluate(const BasicProgram<T>&, std::span<double>), and evaluate() throwing its error
+    [[nodiscard]] Result<std::optional<T>> try_evaluate(std::span<double> slots) const;
+    [[nodiscard]] std::optional<T> evaluate(std::span<double> slots) const;
+  };
+
+  using JitProgram = BasicJitProgram<float>;
+
+  // compile the output of to_rpn() and translate it, explicitly instantiated for float, double and long double in jit.cpp
+  template <typename T = float>
+  [[nodiscard]] BasicJitProgram<T> jit_compile(const Expression& rpn_expr);
+
+  // run a translated program bound to `table` directly over the table's values, like try_evaluate() and evaluate()
+  // over a bound BasicProgram. Explicitly instantiated for float, double and long double in jit.cpp
+  template <typename T>
+  [[nodiscard]] Result<std::optional<T>> try_evaluate(const BasicJitProgram<T>& program, SymbolTable& table);
+  template <typename T>
+  [[nodiscard]] std::optional<T> evaluate(const BasicJitProgram<T>& program, SymbolTable& table);
+}
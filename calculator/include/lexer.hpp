@@ -0,0 +1,54 @@
+#pragma once
+
+#include "error.hpp"
+#include "token.hpp"
+
+#include <array>       // for std::array
+#include <cstdint>     // for std::uint32_t
+#include <optional>    // for std::optional
+#include <string_view> // for std::string_view
+
+namespace sya {
+  /**
+   * @brief A token produced by the Lexer: a view into the source expression (or into a static literal
+   * for implicit tokens, like the '*' of "2x") paired with its type. Lexemes never own memory.
+   */
+  struct Lexeme {
+    std::string_view text;
+    TokenType type = TokenType::UNKNOWN;
+    uint32_t position = 0; // 1-based position of text in the source, 0 for implicit lexemes
+  };
+
+  /**
+   * @brief An allocation-free tokenizer that yields the tokens of an expression one at a time.
+   * It never throws: an invalid expression ends the lexemes early and leaves the reason in error().
+   * The source string must outlive the lexer and every lexeme it returns.
+   */
+  class Lexer {
+    private:
+    std::string_view m_src; // the source expression
+    std::size_t m_pos = 0; // position of the next character to scan
+    std::string_view m_ct; // current token being built, a span of the source
+    int m_pb = 0; // parenthesis balance counter
+    bool m_done = false; // if the whole source has been scanned, or an error stopped the scan
+    std::optional<Error> m_error;
+
+    Lexeme m_last; // last produced lexeme, used for implicit multiplication and unary operators
+    std::size_t m_count = 0; // number of lexemes produced so far
+
+    std::array<Lexeme, 4> m_queue; // lexemes produced by the last scanned character, not yet returned
+    std::size_t m_head = 0, m_tail = 0;
+
+    void push(std::string_view text, TokenType type) noexcept;
+    void push_token(); // push the current token being built, if any
+    void step(); // scan the next character
+    void fail(ErrorCode code, std::size_t pos, std::string_view text = {}) noexcept; // stop the scan on an error
+
+    public:
+    explicit Lexer(std::string_view src) noexcept;
+
+    [[nodiscard]] std::optional<Lexeme> next(); // next lexeme, or std::nullopt at the end of the expression or on an error
+    [[nodiscard]] std::size_t position() const noexcept { return m_pos; } // position of the next character to scan
+    [[nodiscard]] const std::optional<Error>& error() const noexcept { return m_error; } // why the scan stopped early, if it did
+  };
+}
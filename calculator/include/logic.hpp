@@ -1,14 +1,55 @@
 #pragma once
 
+#include "bytecode.hpp"
+#include "error.hpp"
 #include "expression.hpp"
+#include "symbols.hpp"
 #include "variable.hpp"
 
+#include <memory_resource> // for std::pmr::memory_resource
+#include <span> // for std::span
+
 namespace sya {
   struct FunctionInfo {
-    std::string name;
+    std::string_view name; // views the token of the converted expression
     size_t arg_count;
   };
 
-  [[nodiscard]] Expression to_rpn(const Expression& expr);
-  [[nodiscard]] std::optional<float> evaluate_rpn(const Expression& rpn_expr, std::vector<Variable>& variables);
+  /**
+   * @brief A column of values bound to a variable name for batch evaluation.
+   */
+  template <typename T>
+  struct BasicColumn {
+    std::string_view name;
+    std::span<const T> values;
+  };
+
+  using Column = BasicColumn<float>;
+
+  // convert the output of tokenize() with the rules of parse(), so that both accept and reject the same expressions
+  // with the same errors. try_to_rpn() returns them (viewing the tokens of `expr`), to_rpn() throws them.
+  // All the memory of the conversion, the returned expression included, comes from `resource`
+  // (an Arena's to make it a few pointer bumps), copy the result to keep it past the arena's reset
+  [[nodiscard]] Result<Expression> try_to_rpn(const Expression& expr, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+  [[nodiscard]] Expression to_rpn(const Expression& expr, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+  // the evaluators are templates over the scalar type (float, double or long double),
+  // explicitly instantiated in logic.cpp
+  // the evaluation stack and function arguments are allocated from `resource`
+  template <typename T = float>
+  [[nodiscard]] std::optional<T> evaluate_rpn(const Expression& rpn_expr, std::vector<Variable>& variables,
+                                              std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+  // evaluate one expression over whole columns of values, results[i] is computed from row i of every column,
+  // variables without a column are read from `variables` and broadcast to every row
+  template <typename T>
+  void evaluate_batch(const Expression& rpn_expr, std::span<const BasicColumn<T>> columns,
+                      std::span<T> results, const std::vector<Variable>& variables);
+  template <typename T>
+  void evaluate_batch(const BasicProgram<T>& program, std::span<const BasicColumn<T>> columns,
+                      std::span<T> results, const std::vector<Variable>& variables);
+  // the same over a program bound to `table`, variables without a column are read from the table
+  template <typename T>
+  void evaluate_batch(const BasicProgram<T>& program, std::span<const BasicColumn<T>> columns,
+                      std::span<T> results, const SymbolTable& table);
 }
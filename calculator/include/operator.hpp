@@ -1,21 +1,123 @@
 #pragma once
 
-#include <unordered_map>
+#include "error.hpp"
+#include "utils.hpp"
+
+#include <array>       // for std::array
+#include <optional>    // for std::optional
+#include <span>        // for std::span
+#include <string>      // for std::string
+#include <string_view> // for std::string_view
+#include <vector>      // for std::vector
 
 namespace sya {
   enum class OperatorPrec : uint8_t { ADD_SUB = 1, MUL_DIV, POW, ASSIGNEMENT };
-  extern std::unordered_map<std::string, OperatorPrec> operators;
-  extern std::unordered_map<std::string, std::size_t> functions;
-
-  bool is_function(const std::string& token) noexcept;
-  bool is_operator(const std::string& op);
-  bool is_operator(char op);
-  bool is_unary(const std::string& op);
-  bool is_unary(char op);
-  bool is_right_associative(const std::string& op);
-  bool is_right_associative(char op);
-  OperatorPrec opprec(const std::string& op);
-
-  [[nodiscard]] float apply_operator(const std::string& op, float left, float right);
-  [[nodiscard]] float apply_function(const std::string& fn, const std::vector<float>& args);
+
+  /**
+   * @brief Identifiers of the supported functions, also indexes of the function tables.
+   */
+  enum class Function : uint8_t {
+    SQRT, POW, COS, SIN, MAX, MIN, ABS, EXP, LOG, LN, FLOOR,
+    CEIL, ROUND, SIGN, HYPOT, ATAN2, SINH, COSH, TANH, ASINH, ACOSH, ATANH,
+  };
+
+  struct FunctionDef {
+    std::string_view name;
+    std::size_t arity;
+    Function id;
+  };
+
+  // the functions table, built at compile time, entries are in the order of the Function enum
+  inline constexpr std::array<FunctionDef, 22> functions = {{
+    {"sqrt",  1, Function::SQRT},
+    {"pow",   2, Function::POW},
+    {"cos",   1, Function::COS},
+    {"sin",   1, Function::SIN},
+    {"max",   2, Function::MAX},
+    {"min",   2, Function::MIN},
+    {"abs",   1, Function::ABS},
+    {"exp",   1, Function::EXP},
+    {"log",   1, Function::LOG},
+    {"ln",    1, Function::LN},
+    {"floor", 1, Function::FLOOR},
+    {"ceil",  1, Function::CEIL},
+    {"round", 1, Function::ROUND},
+    {"sign",  1, Function::SIGN},
+    {"hypot", 2, Function::HYPOT},
+    {"atan2", 2, Function::ATAN2},
+    {"sinh",  1, Function::SINH},
+    {"cosh",  1, Function::COSH},
+    {"tanh",  1, Function::TANH},
+    {"asinh", 1, Function::ASINH},
+    {"acosh", 1, Function::ACOSH},
+    {"atanh", 1, Function::ATANH},
+  }};
+
+  static_assert([] {
+    for (std::size_t i = 0; i < functions.size(); i++)
+      if (functions[i].id != static_cast<Function>(i)) return false;
+    return true;
+  }(), "functions must be listed in the order of the Function enum");
+
+  inline constexpr auto function_hash = utils::make_perfect_hash<64>(functions);
+
+  // find a function by name in O(1) with no allocation, nullptr if there's no such function
+  constexpr const FunctionDef* find_function(std::string_view name) noexcept {
+    std::size_t i = function_hash.find(functions, name);
+    return i < functions.size() ? &functions[i] : nullptr;
+  }
+  constexpr bool is_function(std::string_view token) noexcept { return find_function(token) != nullptr; }
+  [[nodiscard]] std::size_t function_arity(std::string_view fn); // argument count of a function, throws if unknown
+
+  constexpr bool is_operator(char op) noexcept {
+    switch (op) {
+      case '+': case '-': case '*': case '/': case '^': case '=': return true;
+      default: return false;
+    }
+  }
+  constexpr bool is_operator(std::string_view op) noexcept { return op.size() == 1 && is_operator(op[0]); }
+  constexpr bool is_unary(char op) noexcept { return op == '-' || op == '+'; }
+  constexpr bool is_unary(std::string_view op) noexcept { return op.size() == 1 && is_unary(op[0]); }
+  constexpr bool is_right_associative(char op) noexcept { return op == '^' || op == '='; }
+  constexpr bool is_right_associative(std::string_view op) noexcept { return op.size() == 1 && is_right_associative(op[0]); }
+  constexpr OperatorPrec opprec(std::string_view op) noexcept {
+    switch (op.size() == 1 ? op[0] : '\0') {
+      case '+': case '-': return OperatorPrec::ADD_SUB;
+      case '*': case '/': return OperatorPrec::MUL_DIV;
+      case '^': return OperatorPrec::POW;
+      case '=': return OperatorPrec::ASSIGNEMENT;
+      default: return OperatorPrec{};
+    }
+  }
+
+  template <typename T>
+  using FunctionPtr = T (*)(const T* args); // a math routine taking its arguments in call order
+
+  // the error a math routine throws for these arguments, the exception-free paths check it before calling
+  template <typename T>
+  constexpr std::optional<ErrorCode> domain_error(Function fn, const T* args) noexcept {
+    switch (fn) {
+      case Function::LOG: case Function::LN: if (args[0] <= 0) return ErrorCode::LOG_DOMAIN; break;
+      case Function::ACOSH: if (args[0] < 1) return ErrorCode::ACOSH_DOMAIN; break;
+      case Function::ATANH: if (args[0] <= -1 || args[0] >= 1) return ErrorCode::ATANH_DOMAIN; break;
+      default: break;
+    }
+    return std::nullopt;
+  }
+
+  // the evaluation functions are templates over the scalar type,
+  // explicitly instantiated for float, double and long double in operator.cpp
+  template <typename T>
+  [[nodiscard]] T apply_operator(std::string_view op, T left, T right);
+  template <typename T>
+  [[nodiscard]] T apply_function(std::string_view fn, std::span<const T> args);
+  template <typename T = float>
+  [[nodiscard]] FunctionPtr<T> resolve_function(Function fn) noexcept; // math routine of a function, a table read
+  template <typename T = float>
+  [[nodiscard]] FunctionPtr<T> resolve_function(std::string_view fn); // resolve a function name to its math routine once
+
+  template <typename T>
+  using DerivativePtr = void (*)(const T* args, T value, T* partials); // partials of a function at args, given its value there
+  template <typename T = float>
+  [[nodiscard]] DerivativePtr<T> resolve_derivative(Function fn) noexcept; // derivative rule of a function, a table read
 }
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "bytecode.hpp"
+#include "expression.hpp"
+
+#include <cstddef> // for std::size_t
+
+namespace sya {
+  /**
+   * @brief Fold every subtree of an RPN expression made only of literals, reserved constants and
+   * functions into a single literal, computed in T (the type the expression will be evaluated in).
+   * Subtrees that would fail (like "log(0)" or "1/0") are left as they are, for evaluation to report,
+   * so folding never throws. Returns the number of tokens removed.
+   * Explicitly instantiated for float, double and long double in optimize.cpp.
+   */
+  template <typename T = float>
+  std::size_t fold_constants(Expression& rpn_expr);
+
+  struct CseStats {
+    std::size_t before = 0; // nodes of the expression tree (one per instruction)
+    std::size_t after = 0;  // distinct nodes of the expression DAG
+    std::size_t shared = 0; // subexpressions kept in a temporary, evaluated once
+  };
+
+  /**
+   * @brief Hash-cons a compiled program into a DAG so that every distinct subexpression is evaluated once:
+   * the first occurrence SAVEs its value to a temporary, later ones RECALL it. Results are unchanged.
+   * Programs reading a variable after assigning one are left as they are, as are already shared programs.
+   * Explicitly instantiated for float, double and long double in optimize.cpp.
+   */
+  template <typename T = float>
+  CseStats share_subexpressions(BasicProgram<T>& program);
+
+  // compile the output of to_rpn() with common subexpressions shared, optionally reporting node counts
+  template <typename T = float>
+  [[nodiscard]] BasicProgram<T> compile_shared(const Expression& rpn_expr, CseStats* stats = nullptr);
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include "error.hpp"
+#include "expression.hpp"
+
+#include <memory_resource> // for std::pmr::memory_resource
+#include <string_view>     // for std::string_view
+
+namespace sya {
+  /**
+   * @brief Parse an expression to its RPN form in one pass: a Pratt parser pulls the lexemes straight
+   * from a Lexer and writes the RPN as it goes, with no token vector in between. It accepts what
+   * tokenize() then to_rpn() accept, implicit multiplication and signed literals come from the Lexer,
+   * which also reports the positioned errors first. Assignments chain at the start: "x = y = 1 + 2".
+   * The returned expression is allocated from `resource`, like the output of to_rpn().
+   * Errors are returned with their position in `expr`, which they view, and never thrown.
+   */
+  [[nodiscard]] Result<Expression> try_parse(std::string_view expr, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+  // try_parse() throwing its error, with the exception types tokenize() and to_rpn() throw
+  [[nodiscard]] Expression parse(std::string_view expr, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+}
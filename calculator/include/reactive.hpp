@@ -0,0 +1,58 @@
+#pragma once
+
+#include "bytecode.hpp"
+#include "symbols.hpp"
+
+#include <cstddef>       // for std::size_t
+#include <map>           // for std::map
+#include <string>        // for std::string
+#include <string_view>   // for std::string_view
+#include <unordered_map> // for std::unordered_map
+#include <vector>        // for std::vector
+
+namespace sya {
+  /**
+   * @brief Definitions of variables kept as compiled programs, like the cells of a spreadsheet.
+   * Every assignment becomes the definition of the variables it assigns, reading the variables it loads.
+   * When a definition changes, the definitions depending on it (directly or not) are evaluated again,
+   * each once and in topological order. Definitions that would depend on themselves are rejected.
+   */
+  template <typename T>
+  class BasicDefinitionGraph {
+    public:
+    struct Definition {
+      std::string source;            // the text it was compiled from
+      BasicProgram<T> program;       // bound to the table given to assign()
+      std::vector<std::size_t> inputs;  // table slots it reads
+      std::vector<std::size_t> outputs; // table slots it assigns
+    };
+
+    private:
+    std::map<std::size_t, Definition> m_definitions; // by id, in definition order
+    std::unordered_map<std::size_t, std::size_t> m_owner; // table slot -> id of the definition assigning it
+    std::unordered_map<std::size_t, std::vector<std::size_t>> m_readers; // table slot -> ids of the definitions reading it
+    std::size_t m_next = 0; // id of the next definition
+
+    void drop(std::size_t id) noexcept; // remove a definition and its edges
+    // ids of the definitions depending on `slots`, in an order where every definition comes after its inputs
+    [[nodiscard]] std::vector<std::size_t> affected(const std::vector<std::size_t>& slots) const;
+
+    public:
+    /************************\
+    |         METHODS        |
+    \************************/
+    // evaluate an assignment bound to `table` and keep it as the definition of the variables it assigns,
+    // replacing theirs, then evaluate every definition depending on them again.
+    // Returns the table slots updated by those, in update order. Throws without changing anything
+    // if the definition is cyclic or fails to evaluate, throws if updating a dependent fails.
+    std::vector<std::size_t> assign(std::string_view source, const BasicProgram<T>& program, SymbolTable& table);
+
+    void forget(std::size_t slot) noexcept; // drop the definition assigning a table slot, if any
+    void clear() noexcept;
+
+    [[nodiscard]] const Definition* definition(std::size_t slot) const noexcept; // definition assigning a table slot, or null
+    [[nodiscard]] std::size_t size() const noexcept { return m_definitions.size(); }
+  };
+
+  using DefinitionGraph = BasicDefinitionGraph<double>;
+}
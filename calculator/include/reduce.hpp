@@ -0,0 +1,68 @@
+#pragma once
+
+#include "bytecode.hpp"
+#include "expression.hpp"
+#include "symbols.hpp"
+#include "thread_pool.hpp"
+
+#include <array>       // for std::array
+#include <cstdint>     // for std::uint8_t
+#include <optional>    // for std::optional
+#include <string_view> // for std::string_view
+
+namespace sya {
+  /**
+   * @brief Identifiers of the higher-order built-ins, which evaluate an expression over a range of a variable
+   * they bind: "sum(i^2, i, 1, 100)", "integrate(exp(-x^2), x, 0, 10)" or "root(x^2 - 2, x, 0, 2)".
+   */
+  enum class Reduction : uint8_t { SUM, PROD, INTEGRATE, ROOT };
+
+  struct ReductionDef {
+    std::string_view name;
+    std::size_t arity; // the body, the bound variable and the two bounds
+    Reduction id;
+  };
+
+  // the reductions table, next to the functions table, entries are in the order of the Reduction enum
+  inline constexpr std::array<ReductionDef, 4> reductions = {{
+    {"sum",       4, Reduction::SUM},
+    {"prod",      4, Reduction::PROD},
+    {"integrate", 4, Reduction::INTEGRATE},
+    {"root",      4, Reduction::ROOT},
+  }};
+
+  constexpr const ReductionDef* find_reduction(std::string_view name) noexcept {
+    for (const auto& def : reductions)
+      if (def.name == name) return &def;
+    return nullptr;
+  }
+
+  // the arguments of a reduction, as views of the expression it was matched in
+  struct ReductionCall {
+    const ReductionDef* def;
+    std::string_view body, var, lo, hi;
+  };
+
+  // match an expression that is a whole reduction call, std::nullopt if it doesn't start with one.
+  // Throws std::logic_error if it does but is malformed, or if a reduction is called anywhere else in it:
+  // reductions can't be part of other expressions. Arguments the lexer would misread are rejected too,
+  // exponent notation is only accepted in bounds written as a number and read with number_bound()
+  [[nodiscard]] std::optional<ReductionCall> match_reduction(std::string_view expr);
+
+  // the value of a bound written as a number, exponent notation included ("1e8", "-2.5E-3"), or std::nullopt
+  [[nodiscard]] std::optional<double> number_bound(std::string_view text) noexcept;
+
+  // compile `body` once and evaluate it over the range [lo, hi] of `var`, other variables are read from `table`,
+  // which the program overload's `body` must be bound to (the other overload binds it).
+  // sum and prod run over the integers of the range, integrate uses Gauss-Legendre quadrature on fixed panels
+  // and root a bracketed solver (Brent's method), f(lo) and f(hi) must have opposite signs.
+  // sum, prod and integrate evaluate the range in chunks of blocks with evaluate_batch(), spread over `pool` if
+  // given. Chunks don't depend on the thread count and are combined in order with compensated summation, so
+  // results are reproducible. Explicitly instantiated in reduce.cpp, like evaluate_batch()
+  template <typename T>
+  [[nodiscard]] T reduce(Reduction kind, const Expression& body, std::string_view var, T lo, T hi,
+                         SymbolTable& table, ThreadPool* pool = nullptr);
+  template <typename T>
+  [[nodiscard]] T reduce(Reduction kind, const BasicProgram<T>& body, std::string_view var, T lo, T hi,
+                         const SymbolTable& table, ThreadPool* pool = nullptr);
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "cache.hpp"
+#include "history.hpp"
+#include "symbols.hpp"
+
+#include <cstddef> // for std::size_t
+#include <string>  // for std::string
+
+namespace console {
+  struct SnapshotSummary {
+    std::size_t variables = 0; // defined variables, constants excluded
+    std::size_t history = 0;   // entries kept, the oldest ones may not fit the history limit
+    std::size_t programs = 0;  // compiled expressions of the cache
+  };
+
+  /**
+   * @brief Sessions saved as a versioned binary snapshot: the symbol table, the history and the compiled
+   * programs of the expression cache, laid out as aligned arrays of fixed-size records and a string pool.
+   * Loading maps the file, validates every record against its bounds and copies the arrays out in bulk,
+   * nothing is tokenized nor compiled again: names are interned in their original slot order, so the cached
+   * programs stay bound to the same slots.
+   */
+  // write the session to `path` through a temporary file renamed over it, throws std::runtime_error on failure
+  SnapshotSummary save_snapshot(const std::string& path, const sya::SymbolTable& table,
+                                const HistoryStore& history, const sya::BasicExpressionCache<double>& cache);
+  // replace the session by the snapshot at `path`. Throws std::runtime_error if it can't be read, or was written
+  // by another version or platform, in which case the session is left untouched
+  SnapshotSummary load_snapshot(const std::string& path, sya::SymbolTable& table,
+                                HistoryStore& history, sya::BasicExpressionCache<double>& cache);
+
+  // $CALCULATOR_SESSION, or .calculator_session in the home directory, empty if neither is known
+  [[nodiscard]] std::string default_session_path();
+}
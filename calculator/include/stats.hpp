@@ -0,0 +1,114 @@
+#pragma once
+
+#include "operator.hpp"
+
+#include <array>   // for std::array
+#include <atomic>  // for std::atomic
+#include <chrono>  // for std::chrono::steady_clock
+#include <cstddef> // for std::size_t
+#include <cstdint> // for std::uint64_t
+#include <memory>  // for std::unique_ptr
+#include <mutex>   // for std::mutex
+#include <vector>  // for std::vector
+
+namespace sya {
+  // phases of the pipeline that are timed
+  enum class Phase : uint8_t { TOKENIZE, TO_RPN, PARSE, COMPILE, EVALUATE };
+  inline constexpr std::array<std::string_view, 5> phase_names = { "tokenize", "to_rpn", "parse", "compile", "evaluate" };
+
+  // events that are only counted
+  enum class Counter : uint8_t { VARIABLE_LOOKUPS };
+  inline constexpr std::array<std::string_view, 1> counter_names = { "variable lookups" };
+
+  /**
+   * @brief Latencies in power of two buckets of nanoseconds: bucket b holds latencies in [2^(b-1), 2^b).
+   */
+  struct Histogram {
+    static constexpr std::size_t buckets = 40;
+
+    std::uint64_t count = 0;
+    std::uint64_t total = 0; // ns
+    std::uint64_t max = 0;   // ns
+    std::array<std::uint64_t, buckets> counts{};
+
+    [[nodiscard]] std::uint64_t percentile(double p) const noexcept; // upper bound of the bucket holding it, in ns
+  };
+
+  struct StatsSnapshot {
+    std::array<Histogram, phase_names.size()> phases;
+    std::array<std::uint64_t, functions.size()> calls{}; // by Function
+    std::array<std::uint64_t, counter_names.size()> counters{};
+  };
+
+  /**
+   * @brief Process-wide counters and latency histograms of the pipeline. Every thread writes to its own
+   * cache-line aligned shard with plain relaxed loads and stores (no locked read-modify-write, no false
+   * sharing), and snapshot() sums the shards. Only updated through the SYA_STATS_* macros, which compile
+   * to nothing unless SYA_ENABLE_STATS is defined.
+   */
+  class Stats {
+    private:
+    struct alignas(64) Shard { // written by its thread only
+      struct Phase {
+        std::atomic<std::uint64_t> count{0}, total{0}, max{0};
+        std::array<std::atomic<std::uint64_t>, Histogram::buckets> counts{};
+      };
+
+      std::array<Phase, phase_names.size()> phases;
+      std::array<std::atomic<std::uint64_t>, functions.size()> calls{};
+      std::array<std::atomic<std::uint64_t>, counter_names.size()> counters{};
+    };
+
+    mutable std::mutex m_mutex;                 // guards the two members below
+    std::vector<std::unique_ptr<Shard>> m_shards; // kept once their thread exits, so nothing is lost
+    StatsSnapshot m_baseline;                   // totals at the last reset(), shards are never cleared by others
+
+    Stats() = default;
+    [[nodiscard]] Shard& local() noexcept; // the shard of the calling thread, registered on first use
+    [[nodiscard]] StatsSnapshot total() const noexcept; // sum of the shards, m_mutex held
+
+    friend Stats& stats() noexcept;
+
+    public:
+    Stats(const Stats&) = delete;
+    Stats& operator=(const Stats&) = delete;
+
+    void record(Phase phase, std::uint64_t ns) noexcept;
+    void call(Function fn) noexcept;
+    void count(Counter counter) noexcept;
+
+    [[nodiscard]] StatsSnapshot snapshot() const noexcept;
+    void reset() noexcept;
+  };
+
+  [[nodiscard]] Stats& stats() noexcept; // the process-wide instance
+
+  // records the time from its construction to its destruction as a latency of `phase`
+  class PhaseTimer {
+    private:
+    Phase m_phase;
+    std::chrono::steady_clock::time_point m_start;
+
+    public:
+    explicit PhaseTimer(Phase phase) noexcept : m_phase(phase), m_start(std::chrono::steady_clock::now()) {}
+    ~PhaseTimer() {
+      auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count();
+      stats().record(m_phase, static_cast<std::uint64_t>(ns));
+    }
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+  };
+}
+
+#define SYA_STATS_CONCAT_(a, b) a##b
+#define SYA_STATS_CONCAT(a, b) SYA_STATS_CONCAT_(a, b)
+
+#if defined(SYA_ENABLE_STATS)
+#define SYA_STATS_TIME(phase) const ::sya::PhaseTimer SYA_STATS_CONCAT(sya_timer_, __LINE__)(::sya::Phase::phase)
+#define SYA_STATS_CALL(fn) ::sya::stats().call(fn)
+#define SYA_STATS_COUNT(counter) ::sya::stats().count(::sya::Counter::counter)
+#else
+#define SYA_STATS_TIME(phase) static_cast<void>(0)
+#define SYA_STATS_CALL(fn) static_cast<void>(0)
+#define SYA_STATS_COUNT(counter) static_cast<void>(0)
+#endif
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "variable.hpp"
+
+#include <cstdint>       // for std::uint8_t
+#include <deque>         // for std::deque
+#include <limits>        // for std::numeric_limits
+#include <span>          // for std::span
+#include <string>        // for std::string
+#include <string_view>   // for std::string_view
+#include <unordered_map> // for std::unordered_map
+#include <vector>        // for std::vector
+
+namespace sya {
+  /**
+   * @brief The variables and constants of a session. Every name is interned once and gets a stable slot,
+   * values live in a dense array indexed by slot, so compiled programs read and write them directly.
+   * Constants are seeded as read-only slots. Removing a variable only marks its slot as undefined.
+   */
+  class SymbolTable {
+    private:
+    enum Flags : uint8_t { DEFINED = 1, READ_ONLY = 2 };
+
+    std::deque<std::string> m_names; // name of each slot (a deque, so that index keys stay valid)
+    std::vector<double> m_values; // value of each slot
+    std::vector<uint8_t> m_flags; // Flags of each slot
+    std::unordered_map<std::string_view, std::size_t> m_index; // name -> slot
+
+    public:
+    static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+    /************************\
+    |      CONSTRUCTORS      |
+    \************************/
+    SymbolTable(); // a table holding the reserved constants
+    SymbolTable(const SymbolTable&) = delete; // index keys view the table's own names
+    SymbolTable(SymbolTable&&) noexcept = default;
+
+    SymbolTable& operator=(const SymbolTable&) = delete;
+    SymbolTable& operator=(SymbolTable&&) noexcept = default;
+
+    /************************\
+    |         METHODS        |
+    \************************/
+    void reserve(std::size_t slots); // room for `slots` slots, so that interning many names doesn't rehash
+    std::size_t intern(std::string_view name); // slot of a name, created undefined if it's new
+    [[nodiscard]] std::size_t find(std::string_view name) const noexcept; // slot of a name, or npos
+
+    [[nodiscard]] bool defined(std::size_t slot) const noexcept { return m_flags[slot] & DEFINED; }
+    [[nodiscard]] bool read_only(std::size_t slot) const noexcept { return m_flags[slot] & READ_ONLY; }
+    [[nodiscard]] const std::string& name(std::size_t slot) const noexcept { return m_names[slot]; }
+    [[nodiscard]] double value(std::size_t slot) const noexcept { return m_values[slot]; }
+    [[nodiscard]] std::size_t size() const noexcept { return m_values.size(); } // number of slots
+
+    void define(std::size_t slot) noexcept { m_flags[slot] |= DEFINED; } // mark a slot written through values() as defined
+    void assign(std::size_t slot, double value); // assign and define a slot, throws if it's read-only
+    std::size_t set(std::string_view name, double value); // intern and assign a variable
+
+    bool remove(std::string_view name) noexcept; // undefine a variable, false if not defined or read-only
+    void clear() noexcept; // undefine every variable, constants are kept
+
+    [[nodiscard]] std::span<double> values() noexcept { return m_values; } // the dense value array, indexed by slot
+    [[nodiscard]] std::span<const double> values() const noexcept { return m_values; }
+  };
+}
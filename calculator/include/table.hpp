@@ -0,0 +1,223 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <iterator>
+#include <limits>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <fmt/format.h>
+
+namespace console {
+// the layout shared by the tables, formatted into a buffer written in large blocks
+namespace layout {
+  constexpr std::size_t flush_threshold = 1 << 16; // bytes buffered before writing to the stream
+
+  inline void flush(fmt::memory_buffer& out, std::ostream& os) {
+    os.write(out.data(), static_cast<std::streamsize>(out.size()));
+    out.clear();
+  }
+
+  inline void separator(fmt::memory_buffer& out, std::span<const std::size_t> widths) {
+    out.push_back('+');
+    for (auto width : widths) {
+      for (std::size_t i = 0; i < width + 2; i++) out.push_back('-');
+      out.push_back('+');
+    }
+    out.push_back('\n');
+  }
+
+  // cells is anything indexable holding strings, missing cells are left blank and longer ones overflow
+  template <typename Cells>
+  void row(fmt::memory_buffer& out, const Cells& cells, std::size_t count, std::span<const std::size_t> widths) {
+    out.push_back('|');
+    for (std::size_t i = 0; i < widths.size(); ++i) {
+      std::string_view cell = i < count ? std::string_view(cells[i]) : std::string_view();
+      out.push_back(' ');
+      out.append(cell);
+      for (std::size_t pad = cell.size(); pad < widths[i]; pad++) out.push_back(' '); // widths are in bytes, like std::setw
+      out.append(std::string_view(" |"));
+    }
+    out.push_back('\n');
+  }
+}
+
+class Table {
+public:
+  explicit Table(std::vector<std::string> headers)
+    : headers_(std::move(headers)) {}
+
+  void add_row(std::vector<std::string> row) {
+    rows_.push_back(std::move(row));
+  }
+
+  void add_row(std::initializer_list<std::string> row) {
+    rows_.emplace_back(row);
+  }
+
+  void print(std::ostream& os = std::cout) const {
+    auto widths = compute_widths();
+    fmt::memory_buffer out;
+
+    layout::separator(out, widths);
+    layout::row(out, headers_, headers_.size(), widths);
+    layout::separator(out, widths);
+
+    for (const auto& r : rows_) {
+      layout::row(out, r, r.size(), widths);
+      if (out.size() >= layout::flush_threshold) layout::flush(out, os);
+    }
+
+    layout::separator(out, widths);
+    layout::flush(out, os);
+  }
+
+  size_t row_count() { return rows_.size(); }
+
+private:
+  std::vector<std::string> headers_;
+  std::vector<std::vector<std::string>> rows_;
+
+  std::vector<std::size_t> compute_widths() const {
+    std::vector<std::size_t> w(headers_.size(), 0);
+
+    auto update = [&](const std::vector<std::string>& row) {
+      for (std::size_t i = 0; i < row.size() && i < w.size(); ++i)
+        w[i] = std::max(w[i], row[i].size());
+    };
+
+    update(headers_);
+    for (const auto& r : rows_)
+      update(r);
+
+    return w;
+  }
+};
+
+/**
+ * @brief The cells of a row of a StreamTable, formatted into one buffer reused from row to row.
+ */
+class TableRow {
+public:
+  void add(std::string_view cell) {
+    text_.append(cell);
+    ends_.push_back(text_.size());
+  }
+
+  template <typename... Args>
+  void add(fmt::format_string<Args...> format, Args&&... args) {
+    fmt::format_to(std::back_inserter(text_), format, std::forward<Args>(args)...);
+    ends_.push_back(text_.size());
+  }
+
+  std::string_view operator[](std::size_t i) const noexcept {
+    std::size_t begin = i == 0 ? 0 : ends_[i - 1];
+    return { text_.data() + begin, ends_[i] - begin };
+  }
+
+  size_t size() const noexcept { return ends_.size(); }
+
+  void clear() noexcept {
+    text_.clear();
+    ends_.clear();
+  }
+
+private:
+  fmt::memory_buffer text_;
+  std::vector<std::size_t> ends_; // end of each cell in text_
+};
+
+/**
+ * @brief A table printed as its rows are generated, without keeping them: column widths come from
+ * a fixed schema, or from the first `sample` rows, longer cells further down overflow their column.
+ * Rows are formatted into a buffer written in large blocks, and a page of them can be printed alone.
+ */
+class StreamTable {
+public:
+  static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+  struct Page {
+    std::size_t rows = 0; // rows printed
+    bool more = false;    // if rows were left after the page
+  };
+
+  explicit StreamTable(std::vector<std::string> headers, std::size_t sample = 256)
+    : headers_(std::move(headers)), widths_(headers_.size(), 0), sample_(sample) {
+    for (std::size_t i = 0; i < headers_.size(); ++i) widths_[i] = headers_[i].size();
+  }
+
+  // fix the width of a column, so that it doesn't depend on the sampled rows
+  StreamTable& fixed(std::size_t column, std::size_t width) {
+    widths_[column] = std::max(width, headers_[column].size());
+    fixed_.push_back(column);
+    return *this;
+  }
+
+  // print `count` rows, after skipping the first `first` ones. `next(row)` fills the cells of the next row
+  // and returns false once there are none left. Nothing is printed if there are no rows to print
+  template <typename Generator>
+  Page print(Generator&& next, std::size_t first = 0, std::size_t count = npos, std::ostream& os = std::cout) {
+    Page page;
+    TableRow row;
+    std::vector<std::size_t> widths = widths_;
+
+    for (std::size_t i = 0; i < first; ++i, row.clear()) // skipped rows are generated, never formatted
+      if (!next(row)) return page;
+
+    // the first rows are kept until the widths are known
+    TableRow sampled;
+    std::size_t kept = 0;
+    bool done = false;
+    for (; kept < std::min(sample_, count); ++kept, row.clear()) {
+      if (!next(row)) {
+        done = true;
+        break;
+      }
+      for (std::size_t i = 0; i < headers_.size(); ++i) {
+        std::string_view cell = i < row.size() ? row[i] : std::string_view();
+        sampled.add(cell);
+        if (std::find(fixed_.begin(), fixed_.end(), i) == fixed_.end()) widths[i] = std::max(widths[i], cell.size());
+      }
+    }
+    if (kept == 0) return page;
+
+    fmt::memory_buffer out;
+    layout::separator(out, widths);
+    layout::row(out, headers_, headers_.size(), widths);
+    layout::separator(out, widths);
+
+    std::vector<std::string_view> cells(headers_.size());
+    for (std::size_t r = 0; r < kept; ++r) {
+      for (std::size_t i = 0; i < headers_.size(); ++i) cells[i] = sampled[r * headers_.size() + i];
+      layout::row(out, cells, cells.size(), widths);
+    }
+    page.rows = kept;
+
+    for (; !done && page.rows < count; ++page.rows, row.clear()) {
+      if (!next(row)) {
+        done = true;
+        break;
+      }
+      layout::row(out, row, row.size(), widths);
+      if (out.size() >= layout::flush_threshold) layout::flush(out, os);
+    }
+
+    layout::separator(out, widths);
+    layout::flush(out, os);
+
+    page.more = !done && next(row);
+    return page;
+  }
+
+private:
+  std::vector<std::string> headers_;
+  std::vector<std::size_t> widths_; // at least the header's, or the fixed width
+  std::vector<std::size_t> fixed_;  // columns with a fixed width
+  std::size_t sample_;
+};
+
+} // namespace console
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <condition_variable> // for std::condition_variable
+#include <cstddef>            // for std::size_t
+#include <deque>              // for std::deque
+#include <exception>          // for std::exception_ptr
+#include <functional>         // for std::function
+#include <memory>             // for std::unique_ptr
+#include <mutex>              // for std::mutex
+#include <thread>             // for std::thread
+#include <vector>             // for std::vector
+
+namespace sya {
+  /**
+   * @brief A fixed set of worker threads with one task queue each. Submitted tasks are spread over the queues,
+   * a worker runs its own tasks newest first and steals the oldest tasks of the others when it runs out.
+   * Tasks receive the index of the worker running them, to use per-worker state without locking.
+   */
+  class ThreadPool {
+    public:
+    using Task = std::function<void(std::size_t worker)>;
+
+    private:
+    struct Queue {
+      std::mutex mutex;
+      std::deque<Task> tasks; // the owner pops the back, thieves pop the front
+    };
+
+    std::vector<std::unique_ptr<Queue>> m_queues; // one per worker
+    std::vector<std::thread> m_threads;
+
+    std::mutex m_mutex; // guards everything below
+    std::condition_variable m_wake; // tasks were queued or the pool is stopping
+    std::condition_variable m_idle; // every submitted task finished
+    std::size_t m_queued = 0;  // submitted tasks not taken by a worker yet
+    std::size_t m_pending = 0; // submitted tasks not finished yet
+    std::size_t m_next = 0;    // queue receiving the next submitted task
+    std::exception_ptr m_error; // first exception thrown by a task since the last wait()
+    bool m_stop = false;
+
+    bool take(std::size_t worker, Task& task); // pop an own task, or steal one
+    void work(std::size_t worker);
+
+    public:
+    /************************\
+    |      CONSTRUCTORS      |
+    \************************/
+    explicit ThreadPool(std::size_t threads = 0); // 0 starts one worker per hardware thread
+    ~ThreadPool(); // finishes queued tasks, then joins the workers
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /************************\
+    |         METHODS        |
+    \************************/
+    void submit(Task task);
+    void wait(); // block until every submitted task finished, rethrows the first exception a task threw
+    [[nodiscard]] std::size_t size() const noexcept { return m_threads.size(); }
+  };
+}
@@ -27,15 +27,16 @@ enum class TokenType : uint8_t {
 */
 class Token { // deriving at() and operator[] from ItClasses
 private:
-  std::string m_value;  // token value
+  std::string m_value;  // token value (short values stay in the string's inline buffer, no heap allocation)
   TokenType   m_type; // token type
+  uint32_t    m_position = 0; // 1-based position in the source expression, 0 if unknown (implicit or folded)
 
 public:
   /************************\
   |      CONSTRUCTORS      |
   \************************/
   // Token(std::string_view value);
-  Token(std::string_view value, TokenType type) noexcept; // main ctor
+  Token(std::string_view value, TokenType type, uint32_t position = 0) noexcept; // main ctor
   Token(const Token& t)     = default; // move ctor
   Token()          noexcept = default; // default ctor
   Token(Token&& t) noexcept = default; // move ctor
@@ -56,12 +57,13 @@ public:
   /************************\
   |         METHODS        |
   \************************/
-  [[nodiscard]] constexpr std::string_view view() const noexcept;
+  [[nodiscard]] std::string_view view() const noexcept { return m_value; } // view token value without copying
   void append(std::string_view value);
   bool is_empty() const noexcept; // return if token is empty
   [[nodiscard]] std::string get()  const noexcept;     // get token value
   void set(const std::string& nv); // set token value to an other
   [[nodiscard]] TokenType type() const noexcept;     // get token type
+  [[nodiscard]] uint32_t position() const noexcept { return m_position; } // where the token starts in the source
   void clear(); // clear token value
 
   void swap(Token& t) noexcept; // swap this token's contents with another one.
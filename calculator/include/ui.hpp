@@ -1,101 +1,41 @@
 #pragma once
 
+#include <chrono>
+#include <filesystem>
 #include <iostream>
 #include <string>
 #include <string_view>
 #include <vector>
 #include <unordered_map>
 #include <algorithm>
-#include <iomanip>
+#include <charconv>
+#include <memory>
+#include <span>
 #include <math.h>
 #include <fmt/core.h>
 
+#include "cache.hpp"
+#include "engine.hpp"
+#include "history.hpp"
 #include "logic.hpp"
+#include "operator.hpp"
+#include "reactive.hpp"
+#include "reduce.hpp"
+#include "snapshot.hpp"
+#include "stats.hpp"
+#include "symbols.hpp"
+#include "table.hpp"
 
 namespace console {
-struct HistoryEntry {
-  size_t id;
-  std::string expression;
-  std::string result;
-};
-
-class Table {
-public:
-  explicit Table(std::vector<std::string> headers)
-    : headers_(std::move(headers)) {}
-
-  void add_row(std::vector<std::string> row) {
-    rows_.push_back(std::move(row));
-  }
-
-  void add_row(std::initializer_list<std::string> row) {
-    rows_.emplace_back(row);
-  }
-
-  void print(std::ostream& os = std::cout) const {
-    auto widths = compute_widths();
-
-    print_separator(os, widths);
-    print_row(os, headers_, widths);
-    print_separator(os, widths);
-
-    for (const auto& r : rows_)
-      print_row(os, r, widths);
-
-    print_separator(os, widths);
-  }
-
-  size_t row_count() { return rows_.size(); }
-
-private:
-  std::vector<std::string> headers_;
-  std::vector<std::vector<std::string>> rows_;
-
-  std::vector<std::size_t> compute_widths() const {
-    std::vector<std::size_t> w(headers_.size(), 0);
-
-    auto update = [&](const std::vector<std::string>& row) {
-      for (std::size_t i = 0; i < row.size(); ++i)
-        w[i] = std::max(w[i], row[i].size());
-    };
-
-    update(headers_);
-    for (const auto& r : rows_)
-      update(r);
-
-    return w;
-  }
-
-  static void print_separator(std::ostream& os,
-                              const std::vector<std::size_t>& w) {
-    os << '+';
-    for (auto width : w) {
-      os << std::string(width + 2, '-') << '+';
-    }
-    os << '\n';
-  }
-
-  static void print_row(std::ostream& os,
-                        const std::vector<std::string>& row,
-                        const std::vector<std::size_t>& w) {
-    os << '|';
-    for (std::size_t i = 0; i < row.size(); ++i) {
-      os << ' '
-         << std::left << std::setw(w[i]) << row[i]
-         << ' ' << '|';
-    }
-    os << '\n';
-  }
-};
-
-
 class Interface {
 public:
-  Interface(std::unordered_map<std::string, std::size_t> functions)
-    : m_functions(std::move(functions)), variables(sya::constants) {}
+  // the session is loaded from and saved to `session` by default, none if it's empty
+  explicit Interface(const sya::Engine& engine = sya::Engine::shared(), std::string session = {})
+    : m_engine(engine), m_session(std::move(session)) {}
 
   void run() {
     print_banner();
+    if (!m_session.empty() && std::filesystem::exists(m_session)) load(m_session);
 
     while (true) {
       std::string input = "";
@@ -103,33 +43,47 @@ public:
       std::cout << "> ";
       if (!std::getline(std::cin, input)) break;
       
-      if (input.empty()) continue;
-      if (input[0] == ':') {
-        if (!handle_command(input.substr(1))) break;
-      }
-      else handle_expression(input);
-
-      m_expr.clear();
+      if (!handle(input)) break;
     }
   }
 
+  // handle one line of input, a command or an expression, false if it quits
+  bool handle(std::string_view input) {
+    if (input.empty()) return true;
+    if (input[0] == ':') return handle_command(input.substr(1));
+
+    handle_expression(input);
+    return true;
+  }
+
 private:
   std::unordered_map<std::string, std::string> commands = {
     { ":help", "Show available commands" },
     { ":functions", "List supported functions" },
     { ":clear", "Clear the screen" },
     { ":quit",  "Exit program" },
-    { ":history", "Show calculation history" },
-    { ":variables", "Show defined variables" },
+    { ":history", "Show calculation history, ':history last N', ':history grep <text>', ':history --page N' or ':history limit [bytes]'" },
+    { ":variables", "Show defined variables, a page at a time with ':variables --page N'" },
     { ":clear_history", "Clear calculation history" },
     { ":clear_vars", "Clear defined variables" },
     { ":clear_all", "Clear both history and variables" },
-    { ":remove_variable", "Remove a specific variable by name" }
+    { ":remove_variable", "Remove a specific variable by name" },
+    { ":cache", "Show expression cache statistics" },
+    { ":reactive", "Toggle reactive mode: assignments are kept as definitions and update their dependents" },
+    { ":definitions", "Show the definitions kept in reactive mode" },
+    { ":stats", "Show timings of each phase and call counts, ':stats reset' to reset them" },
+    { ":save", "Save variables, history and compiled expressions, to the session file or ':save <file>'" },
+    { ":load", "Replace the session by a saved one, from the session file or ':load <file>'" }
   };
-  std::unordered_map<std::string, std::size_t> m_functions;
-  std::vector<sya::Variable> variables;
-  std::vector<HistoryEntry> history;
-  sya::Expression m_expr;
+  const sya::Engine& m_engine; // registries, shared and never modified
+  sya::SymbolTable variables; // constants and user variables, constants are read-only slots
+  HistoryStore history; // bounded, the oldest entries are dropped first
+  sya::BasicExpressionCache<double> m_cache; // compiled form of recently evaluated expressions
+  sya::DefinitionGraph m_definitions; // assignments kept in reactive mode
+  bool m_reactive = false;
+  static constexpr size_t page_size = 100; // rows of a listing shown by --page
+  std::unique_ptr<sya::ThreadPool> m_pool; // started by the first reduction
+  std::string m_session; // default snapshot file
 
   void print_banner() const {
     std::cout
@@ -145,37 +99,52 @@ private:
     if (cmd == "help") print_help();
     else if (cmd == "functions") print_functions();
     else if (cmd == "clear") clear();
-    else if (cmd == "history") {
-      if (history.empty()) {
-        std::cout << "No history available.\n";
-        return true;
-      }
-      Table t({ "ID", "Expression", "Result" });
-      for (const auto& entry : history)
-        t.add_row({ std::to_string(entry.id), entry.expression, entry.result });
+    else if (cmd == "history" || cmd.starts_with("history ")) handle_history(cmd.substr(7));
+    else if (cmd == "variables" || cmd.starts_with("variables ")) print_variables(cmd.substr(9));
+    else if (cmd == "constants") {
+      Table t({ "Name", "Value" });
+
+      for (const auto& [name, value] : m_engine.constants())
+        t.add_row({ std::string(name), std::to_string(value) });
       t.print();
     }
-    else if (cmd=="variables") {
-      Table t({ "Name", "Value" });
+    else if (cmd == "cache") {
+      auto stats = m_cache.stats();
+      Table t({ "Entries", "Bytes", "Hits", "Misses", "Evictions" });
+      t.add_row({ std::to_string(stats.entries), std::to_string(stats.bytes), std::to_string(stats.hits),
+                  std::to_string(stats.misses), std::to_string(stats.evictions) });
+      t.print();
+    }
+    else if (cmd == "reactive") {
+      m_reactive = !m_reactive;
+      m_definitions.clear(); // definitions don't follow changes made outside of reactive mode
+      std::cout << "Reactive mode " << (m_reactive ? "enabled" : "disabled") << ".\n";
+    }
+    else if (cmd == "definitions") {
+      Table t({ "Name", "Definition", "Value" });
 
-      for (const auto& [name, value] : variables) {
-        if (sya::is_constant(name)) continue; // skip constants in variable listing
-        t.add_row({ name, std::to_string(value) });
+      for (size_t slot = 0; slot < variables.size(); slot++) {
+        const auto* def = m_definitions.definition(slot);
+        if (def) t.add_row({ variables.name(slot), def->source, std::to_string(variables.value(slot)) });
       }
 
       if (t.row_count() == 0) {
-        std::cout << "No variables defined.\n";
+        std::cout << "No definitions.\n";
         return true;
       }
 
       t.print();
     }
-    else if (cmd == "constants") {
-      Table t({ "Name", "Value" });
-
-      for (const auto& [name, value] : sya::constants)
-        t.add_row({ name, std::to_string(value) });
-      t.print();
+    else if (cmd == "save" || cmd.starts_with("save ")) save(session_path(cmd.substr(4)));
+    else if (cmd == "load" || cmd.starts_with("load ")) load(session_path(cmd.substr(4)));
+    else if (cmd == "stats") print_stats();
+    else if (cmd == "stats reset") {
+#if defined(SYA_ENABLE_STATS)
+      sya::stats().reset();
+      std::cout << "Statistics reset.\n";
+#else
+      print_stats();
+#endif
     }
     else if (cmd=="clear_history") {
       history.clear();
@@ -195,15 +164,13 @@ private:
       std::cout << "Enter variable name to remove: ";
       std::cin >> var_name;
 
-      if (sya::is_constant(var_name)) {
+      auto slot = variables.find(var_name);
+      if (slot != sya::SymbolTable::npos && variables.read_only(slot)) {
         std::cout << fmt::format(
           "Error: Cannot remove variable: {}, it is a reserved constant.\n", var_name);
       } else {
-
-        auto it = std::find_if(variables.begin(), variables.end(), [&](const sya::Variable var)
-                                                                  { return var.name == var_name; });
-        if (it != variables.end()) {
-          variables.erase(it);
+        if (variables.remove(var_name)) {
+          m_definitions.forget(slot);
           std::cout << "Variable '" << var_name << "' removed.\n";
         } else {
           std::cout << "Variable '" << var_name << "' not found.\n";
@@ -217,14 +184,194 @@ private:
 
   void handle_expression(std::string_view expr) {
     try {
-      m_expr.set_expression(expr);
-      m_expr.tokenize();
+      if (auto call = sya::match_reduction(expr)) {
+        handle_reduction(*call, expr);
+        return;
+      }
+
+      // compiled in the precision variables are stored in, with its variables interned once,
+      // repeated expressions skip parse() entirely. Invalid ones come back as error codes, not exceptions
+      auto compiled = m_cache.try_get(expr, variables);
+      if (!compiled) {
+        std::cout << "Error: " << compiled.error().message() << "\n";
+        return;
+      }
+      const auto& program = (*compiled)->program;
+
+      if (m_reactive && program.assigns) {
+        // keep the assignment as a definition and show the variables it updated downstream
+        for (auto slot : m_definitions.assign(expr, program, variables))
+          std::cout << "   " << variables.name(slot) << " => " << variables.value(slot) << "\n";
+        return;
+      }
+
+      auto result = sya::try_evaluate(program, variables);
+      if (!result) {
+        std::cout << "Error: " << result.error().message() << "\n";
+        return;
+      }
+      if (result->has_value()) {
+        history.add(expr, **result);
+        std::cout << "=> " << **result << "\n";
+      }
+    }
+    catch (const std::exception& e) {
+      std::cout << "Error: " << e.what() << "\n";
+    }
+  }
+
+  // a reduction compiles its body once, binds it to the variables and evaluates it over the whole range on the pool
+  void handle_reduction(const sya::ReductionCall& call, std::string_view expr) {
+    auto bound = [&](std::string_view text) {
+      if (auto number = sya::number_bound(text)) return *number; // "1e8", which expressions can't write
+      auto value = m_engine.evaluate<double>(text, variables);
+      if (!value) throw std::logic_error(fmt::format("Invalid bound: '{}' has no value", text));
+      return *value;
+    };
+    const double lo = bound(call.lo), hi = bound(call.hi);
+
+    auto body = m_engine.compile<double>(call.body);
+    sya::bind(body, variables);
+
+    if (!m_pool) m_pool = std::make_unique<sya::ThreadPool>();
+    double result = sya::reduce<double>(call.def->id, body, call.var, lo, hi, variables, m_pool.get());
+
+    history.add(expr, result);
+    std::cout << "=> " << result << "\n";
+  }
+
+  void handle_history(std::string_view args) {
+    while (!args.empty() && args.front() == ' ') args.remove_prefix(1);
+
+    auto number = [](std::string_view text, size_t& value) {
+      auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+      return error == std::errc() && end == text.data() + text.size();
+    };
+
+    if (args.starts_with("limit")) {
+      auto value = args.substr(5);
+      while (!value.empty() && value.front() == ' ') value.remove_prefix(1);
 
-      auto result = sya::evaluate_rpn(sya::to_rpn(m_expr), variables);
-      if (result.has_value()) {
-        history.push_back(HistoryEntry{ history.size() + 1, std::string(expr), std::to_string(result.value()) });
-        std::cout << "=> " << result.value() << "\n";
+      size_t bytes = 0;
+      if (!value.empty()) {
+        if (!number(value, bytes)) {
+          std::cout << "Error: expected a number of bytes, like ':history limit 1048576'.\n";
+          return;
+        }
+        history.set_limit(bytes);
+      }
+      std::cout << fmt::format("History: {} entries, {} of {} bytes.\n", history.size(), history.bytes(), history.limit());
+      return;
+    }
+
+    auto print = [](auto&& entry_at, size_t size, size_t page) {
+      size_t i = 0;
+      auto next = [&](TableRow& row) {
+        if (i == size) return false;
+        const HistoryEntry entry = entry_at(i++);
+        row.add("{}", entry.id);
+        row.add(entry.expression);
+        row.add("{:f}", entry.result);
+        return true;
+      };
+      print_page(StreamTable({ "ID", "Expression", "Result" }), next, page, "No history available.", ":history");
+    };
+
+    size_t page = 0;
+    if (args.empty() || args.starts_with("--page")) { // every entry, streamed from the store
+      if (!page_of(args, page)) return;
+      print([&](size_t i) { return history[i]; }, history.size(), page);
+    }
+    else if (args.starts_with("last ")) {
+      size_t n = 0;
+      if (!number(args.substr(5), n)) {
+        std::cout << "Error: expected a number of entries, like ':history last 10'.\n";
+        return;
+      }
+      n = std::min(n, history.size());
+      print([&](size_t i) { return history[history.size() - n + i]; }, n, 0);
+    }
+    else if (args.starts_with("grep ")) {
+      auto entries = history.grep(args.substr(5));
+      print([&](size_t i) { return entries[i]; }, entries.size(), 0);
+    }
+    else std::cout << "Unknown command. Use :help\n";
+  }
+
+  void print_variables(std::string_view args) {
+    size_t page = 0;
+    if (!page_of(args, page)) return;
+
+    size_t slot = 0;
+    auto next = [&](TableRow& row) {
+      for (; slot < variables.size(); slot++) {
+        if (!variables.defined(slot) || variables.read_only(slot)) continue; // skip constants in variable listing
+        row.add(variables.name(slot));
+        row.add("{:f}", variables.value(slot));
+        slot++;
+        return true;
       }
+      return false;
+    };
+    print_page(StreamTable({ "Name", "Value" }), next, page, "No variables defined.", ":variables");
+  }
+
+  // "--page N" (1-based) or nothing for every row as 0, false after reporting a malformed option
+  static bool page_of(std::string_view args, size_t& page) {
+    while (!args.empty() && args.front() == ' ') args.remove_prefix(1);
+    page = 0;
+    if (args.empty()) return true;
+
+    if (args.starts_with("--page ")) {
+      args.remove_prefix(7);
+      auto [end, error] = std::from_chars(args.data(), args.data() + args.size(), page);
+      if (error == std::errc() && end == args.data() + args.size() && page != 0) return true;
+    }
+    std::cout << "Error: expected a page number, like '--page 2'.\n";
+    return false;
+  }
+
+  // print every row, or only page `page` of them with a hint to the next one
+  template <typename Generator>
+  static void print_page(StreamTable table, Generator&& next, size_t page, std::string_view empty, std::string_view command) {
+    auto printed = page == 0 ? table.print(next) : table.print(next, (page - 1) * page_size, page_size);
+    if (printed.rows == 0) std::cout << (page > 1 ? "No rows on this page." : empty) << "\n";
+    else if (printed.more) std::cout << fmt::format("Page {}, next with '{} --page {}'.\n", page, command, page + 1);
+  }
+
+  // the file given to a command, or the session file
+  std::string session_path(std::string_view arg) const {
+    while (!arg.empty() && arg.front() == ' ') arg.remove_prefix(1);
+    return arg.empty() ? m_session : std::string(arg);
+  }
+
+  void save(const std::string& path) {
+    if (path.empty()) {
+      std::cout << "Error: no session file, use ':save <file>'.\n";
+      return;
+    }
+    try {
+      auto summary = console::save_snapshot(path, variables, history, m_cache);
+      std::cout << fmt::format("Session saved to '{}': {} variables, {} history entries, {} compiled expressions.\n",
+                               path, summary.variables, summary.history, summary.programs);
+    }
+    catch (const std::exception& e) {
+      std::cout << "Error: " << e.what() << "\n";
+    }
+  }
+
+  void load(const std::string& path) {
+    if (path.empty()) {
+      std::cout << "Error: no session file, use ':load <file>'.\n";
+      return;
+    }
+    try {
+      const auto start = std::chrono::steady_clock::now();
+      auto summary = console::load_snapshot(path, variables, history, m_cache);
+      m_definitions.clear(); // definitions are not part of a snapshot
+      const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+      std::cout << fmt::format("Session loaded from '{}' in {:.1f} ms: {} variables, {} history entries, {} compiled expressions.\n",
+                               path, elapsed.count(), summary.variables, summary.history, summary.programs);
     }
     catch (const std::exception& e) {
       std::cout << "Error: " << e.what() << "\n";
@@ -241,23 +388,51 @@ private:
   void print_functions() const {
     Table t({ "Function", "Args" });
 
-    for (const auto& [name, argc] : m_functions)
-      t.add_row({ name, std::to_string(argc) });
+    for (const auto& fn : m_engine.functions())
+      t.add_row({ std::string(fn.name), std::to_string(fn.arity) });
+    for (const auto& fn : m_engine.reductions())
+      t.add_row({ std::string(fn.name), std::to_string(fn.arity) });
 
     t.print();
   }
 
-  void clear_variables() {
-    size_t len = variables.size()-sya::constants.size();
-    std::vector<sya::Variable> temp;
-    temp.reserve(len);
+  void print_stats() const {
+#if defined(SYA_ENABLE_STATS)
+    auto snapshot = sya::stats().snapshot();
 
-    for (const auto& var : variables)  {
-      if (sya::is_constant(var.name)) temp.push_back(var);
-      continue;
+    Table phases({ "Phase", "Count", "Total (ms)", "Mean (ns)", "p50 (ns)", "p99 (ns)", "Max (ns)" });
+    for (size_t p = 0; p < snapshot.phases.size(); p++) {
+      const auto& h = snapshot.phases[p];
+      if (h.count == 0) {
+        phases.add_row({ std::string(sya::phase_names[p]), "0", "-", "-", "-", "-", "-" });
+        continue;
+      }
+      // percentiles are upper bounds of power of two buckets
+      phases.add_row({ std::string(sya::phase_names[p]), std::to_string(h.count), fmt::format("{:.3f}", h.total / 1e6),
+                       std::to_string(h.total / h.count), fmt::format("<{}", h.percentile(0.5)),
+                       fmt::format("<{}", h.percentile(0.99)), std::to_string(h.max) });
     }
+    phases.print();
 
-    variables = temp;
+    Table calls({ "Function", "Calls" });
+    for (const auto& fn : m_engine.functions()) {
+      auto count = snapshot.calls[static_cast<size_t>(fn.id)];
+      if (count != 0) calls.add_row({ std::string(fn.name), std::to_string(count) });
+    }
+    if (calls.row_count() != 0) calls.print();
+
+    Table counters({ "Counter", "Count" });
+    for (size_t c = 0; c < snapshot.counters.size(); c++)
+      counters.add_row({ std::string(sya::counter_names[c]), std::to_string(snapshot.counters[c]) });
+    counters.print();
+#else
+    std::cout << "Statistics are disabled in this build, configure with -DCALCULATOR_ENABLE_STATS=ON.\n";
+#endif
+  }
+
+  void clear_variables() {
+    variables.clear();
+    m_definitions.clear();
   }
 
   static void clear() {
@@ -5,9 +5,18 @@
 #include <string_view>   // for std::string_view
 #include <stdexcept>     // for std::runtime_error
 #include <unordered_map> // for std::unordered_map
-#include <charconv>
+#include <charconv>      // for std::from_chars
+#include <array>         // for std::array
+#include <cstdint>       // for std::uint32_t, std::uint8_t
 
 namespace utils {  
+  // ASCII character classes, inlined table-free tests instead of the locale-aware <cctype> calls,
+  // the lexer runs them on every character
+  constexpr bool is_digit(char c) noexcept { return c >= '0' && c <= '9'; }
+  constexpr bool is_alpha(char c) noexcept { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); }
+  constexpr bool is_alnum(char c) noexcept { return is_digit(c) || is_alpha(c); }
+  constexpr bool is_space(char c) noexcept { return c == ' ' || (c >= '\t' && c <= '\r'); }
+
   inline bool is_number(std::string_view sv) noexcept {
       if (sv.empty()) return false;
 
@@ -24,7 +33,7 @@ namespace utils {
       for (; i < sv.size(); ++i) {
         char c = sv[i];
 
-        if (std::isdigit(c)) {
+        if (is_digit(c)) {
           has_digit = true;
           continue;
         }
@@ -45,7 +54,7 @@ namespace utils {
         if (i == sv.size()) return false;
         bool exp_digit = false;
         for (; i < sv.size(); ++i) {
-            if (!std::isdigit(sv[i])) return false;
+            if (!is_digit(sv[i])) return false;
             exp_digit = true;
         }
         return exp_digit;
@@ -54,7 +63,73 @@ namespace utils {
     return i == sv.size();
   }
 
+  /**
+   * @brief Parse a number token (as accepted by is_number()) to the given floating point type.
+   */
+  template <typename T>
+  inline std::errc parse_number(std::string_view sv, T& value) noexcept { // without throwing, std::errc{} on success
+    if (!sv.empty() && sv.front() == '+') sv.remove_prefix(1); // std::from_chars doesn't accept an explicit plus sign
+
+    auto [ptr, ec] = std::from_chars(sv.data(), sv.data() + sv.size(), value);
+    if (ec == std::errc() && ptr != sv.data() + sv.size()) return std::errc::invalid_argument;
+    return ec;
+  }
+  template <typename T>
+  inline T parse_number(std::string_view sv) {
+    T value{};
+    std::errc ec = parse_number(sv, value);
+    if (ec == std::errc::result_out_of_range)
+      throw std::out_of_range("Number out of range: " + std::string(sv));
+    if (ec != std::errc())
+      throw std::invalid_argument("Invalid number: " + std::string(sv));
+    return value;
+  }
+
   constexpr inline bool is_letter(const char& c) noexcept {
-    return std::isalpha(c) || c == '_';
+    return is_alpha(c) || c == '_';
+  }
+
+  constexpr inline std::uint32_t hash(std::string_view sv, std::uint32_t seed) noexcept { // seeded FNV-1a
+    std::uint32_t h = 2166136261u ^ seed;
+    for (char c : sv) {
+      h ^= static_cast<unsigned char>(c);
+      h *= 16777619u;
+    }
+    return h ^ (h >> 15);
+  }
+
+  /**
+   * @brief A perfect hash over the names of a fixed table: every name lands in a bucket of its own,
+   * so a lookup is one hash, one bucket read and one string compare.
+   */
+  template <std::size_t Buckets>
+  struct PerfectHash {
+    std::uint32_t seed = 0;
+    std::array<std::uint8_t, Buckets> slots{}; // index of the table entry in each bucket + 1, 0 if empty
+
+    // return the index of `name` in the table, or table.size() if it isn't in it
+    template <typename Table>
+    constexpr std::size_t find(const Table& table, std::string_view name) const noexcept {
+      std::uint8_t s = slots[hash(name, seed) % Buckets];
+      return (s != 0 && table[s - 1].name == name) ? s - 1 : table.size();
+    }
+  };
+
+  // search, at compile time, for a seed that maps every name of `table` (entries with a `name` member) to its own bucket
+  template <std::size_t Buckets, typename Table>
+  consteval PerfectHash<Buckets> make_perfect_hash(const Table& table) {
+    static_assert(Buckets < 256 && std::tuple_size_v<Table> < Buckets, "too many entries for the perfect hash");
+
+    for (std::uint32_t seed = 0;; seed++) {
+      PerfectHash<Buckets> ph{seed, {}};
+      bool collision = false;
+
+      for (std::size_t i = 0; i < table.size() && !collision; i++) {
+        auto& slot = ph.slots[hash(table[i].name, seed) % Buckets];
+        if (slot != 0) collision = true;
+        else slot = static_cast<std::uint8_t>(i + 1);
+      }
+      if (!collision) return ph;
+    }
   }
 } // namespace utils
@@ -1,13 +1,39 @@
 #pragma once
 
+#include "utils.hpp"
+
+#include <array>       // for std::array
+#include <string>      // for std::string
+#include <string_view> // for std::string_view
+#include <vector>      // for std::vector
+
 namespace sya {
   struct Variable {
     std::string name;
     double value;
   };
 
-  extern std::vector<Variable> constants;
+  struct Constant {
+    std::string_view name;
+    double value;
+  };
+
+  // reserved constants, built at compile time
+  inline constexpr std::array<Constant, 4> constants = {{
+    {"pi",    3.14159265358979323846},
+    {"e",     2.71828182845904523536},
+    {"phi",   1.61803398874989484820},
+    {"gamma", 0.57721566490153286060},
+  }};
+
+  inline constexpr auto constant_hash = utils::make_perfect_hash<8>(constants);
+
+  // find a constant by name in O(1) with no allocation, nullptr if there's no such constant
+  constexpr const Constant* find_constant(std::string_view name) noexcept {
+    std::size_t i = constant_hash.find(constants, name);
+    return i < constants.size() ? &constants[i] : nullptr;
+  }
+  constexpr bool is_constant(std::string_view name) noexcept { return find_constant(name) != nullptr; }
 
-  bool validate_variable_name(const std::string& name) noexcept;
-  bool is_constant(const std::string& name) noexcept;
-}
\ No newline at end of file
+  bool validate_variable_name(std::string_view name) noexcept;
+}
@@ -0,0 +1,31 @@
+#include "arena.hpp"
+
+#include <new> // for std::nothrow, std::align_val_t
+
+namespace sya {
+  void* Arena::Overflow::do_allocate(std::size_t size, std::size_t align) {
+    bytes += size;
+    return ::operator new(size, std::align_val_t(align));
+  }
+  void Arena::Overflow::do_deallocate(void* p, std::size_t size, std::size_t align) {
+    ::operator delete(p, size, std::align_val_t(align));
+  }
+
+  Arena::Arena(std::size_t size) : m_buffer(new std::byte[size]), m_size(size) {
+    m_resource.emplace(m_buffer.get(), m_size, &m_overflow);
+  }
+
+  void Arena::reset() noexcept {
+    m_resource->release(); // gives the overflow chunks back, and rewinds to the start of the buffer
+    if (m_overflow.bytes == 0) return;
+
+    // it overflowed: grow the buffer to what was used, keeping the old one if the heap says no
+    const std::size_t size = m_size + m_overflow.bytes;
+    m_overflow.bytes = 0;
+    if (std::byte* buffer = new (std::nothrow) std::byte[size]) {
+      m_resource.emplace(buffer, size, &m_overflow);
+      m_buffer.reset(buffer);
+      m_size = size;
+    }
+  }
+}
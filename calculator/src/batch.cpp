@@ -0,0 +1,287 @@
+#include "batch.hpp"
+#include "bytecode.hpp"
+#include "engine.hpp"
+#include "parser.hpp"
+
+#include <algorithm> // for std::all_of, std::copy, std::min
+#include <cstring>   // for std::memchr
+#include <functional> // for std::hash
+#include <stdexcept> // for std::runtime_error
+#include <vector>    // for std::vector
+
+#if defined(_WIN32)
+#include <fstream>   // for std::ifstream
+#include <iterator>  // for std::istreambuf_iterator
+#else
+#include <fcntl.h>    // for open
+#include <sys/mman.h> // for mmap, munmap, madvise
+#include <sys/stat.h> // for fstat
+#include <unistd.h>   // for close
+#endif
+
+namespace console {
+  namespace {
+    constexpr std::size_t flush_threshold = 1 << 16; // bytes buffered before writing to the sink
+    constexpr std::size_t read_block = 1 << 20;
+    constexpr std::size_t window_lines = 1 << 16; // lines read ahead for parallel evaluation
+    constexpr std::size_t parallel_lines = 256;   // fewer independent lines are evaluated on the calling thread
+
+    bool blank(std::string_view text) {
+      return std::all_of(text.begin(), text.end(), [](char c) { return c == ' ' || c == '\t' || c == '\r'; });
+    }
+
+    // evaluate a line without keeping its program: neither folded nor cached, most lines of a batch are only seen once
+    sya::Result<std::optional<double>> evaluate_once(std::string_view text, sya::SymbolTable& table) {
+      sya::Scratch& scratch = sya::thread_scratch();
+      const sya::ArenaScope scope(scratch.arena);
+      auto rpn = sya::try_parse(text, scratch.arena.resource());
+      if (!rpn) return std::unexpected(rpn.error());
+
+      auto program = sya::try_compile<double>(*rpn);
+      if (!program) return std::unexpected(sya::locate(program.error(), text));
+      sya::bind(*program, table);
+
+      auto result = sya::try_evaluate(*program, table);
+      if (!result) return std::unexpected(sya::locate(result.error(), text)); // the program and its names are about to go
+      return result;
+    }
+  }
+
+  BatchRunner::BatchRunner(ErrorPolicy policy, std::size_t jobs, std::FILE* sink) : m_sink(sink), m_policy(policy) {
+    if (jobs == 1) return;
+
+    m_pool = std::make_unique<sya::ThreadPool>(jobs);
+    for (std::size_t i = 0; i < m_pool->size(); i++) m_workers.push_back(std::make_unique<Context>());
+  }
+
+  bool BatchRunner::evaluate(Context& ctx, Line line, fmt::memory_buffer& out, BatchSummary& summary, std::string& error) {
+    summary.lines++;
+
+    // invalid lines come back as error codes, their message is only formatted if it's written
+    auto failed = [&](auto&& message) {
+      summary.errors++;
+      switch (m_policy) {
+        case ErrorPolicy::SKIP: return true;
+        case ErrorPolicy::EMIT: fmt::format_to(std::back_inserter(out), "Error: line {}: {}\n", line.number, message()); return true;
+        case ErrorPolicy::ABORT: error = fmt::format("Error: line {}: {}\n", line.number, message()); return false;
+      }
+      return true;
+    };
+
+    try {
+      // a line is only compiled into the cache the second time it's seen, its hash is kept the first time
+      const std::size_t hash = std::hash<std::string_view>{}(line.text);
+      std::size_t& seen = ctx.seen[hash & (ctx.seen.size() - 1)];
+      const bool repeated = seen == hash;
+      seen = hash;
+
+      sya::Result<std::optional<double>> result;
+      if (repeated) {
+        auto compiled = ctx.cache.try_get(line.text, ctx.variables);
+        if (!compiled) return failed([&] { return compiled.error().message(); });
+        result = sya::try_evaluate((*compiled)->program, ctx.variables);
+      }
+      else result = evaluate_once(line.text, ctx.variables);
+      if (!result) return failed([&] { return result.error().message(); });
+      if (result->has_value()) {
+        fmt::format_to(std::back_inserter(out), "{}\n", **result);
+        summary.results++;
+      }
+    }
+    catch (const std::exception& e) {
+      return failed([&] { return std::string(e.what()); });
+    }
+    return true;
+  }
+
+  bool BatchRunner::stop(const std::string& error) {
+    flush(); // results so far come before the error
+    std::fputs(error.c_str(), stderr);
+    m_summary.aborted = true;
+    return false;
+  }
+
+  bool BatchRunner::lines(std::string_view text) {
+    while (!text.empty()) {
+      const char* end = static_cast<const char*>(std::memchr(text.data(), '\n', text.size()));
+      const std::size_t length = end ? static_cast<std::size_t>(end - text.data()) : text.size();
+
+      Line line{text.substr(0, length), ++m_number};
+      text.remove_prefix(end ? length + 1 : length);
+
+      if (!line.text.empty() && line.text.back() == '\r') line.text.remove_suffix(1); // CRLF input
+      if (blank(line.text)) continue;
+
+      if (m_pool) {
+        m_window.push_back(line);
+        if (m_window.size() == window_lines && !run_window()) return false;
+        continue;
+      }
+
+      std::string error;
+      if (!evaluate(m_main, line, m_out, m_summary, error)) return stop(error);
+      if (m_out.size() >= flush_threshold) flush();
+    }
+
+    return !m_pool || run_window(); // the window views text, it can't outlive this call
+  }
+
+  bool BatchRunner::run_window() {
+    std::size_t begin = 0;
+
+    for (std::size_t i = 0; i < m_window.size(); i++) {
+      // only assignments contain '=', they depend on every line before them and every line after depends on them
+      if (m_window[i].text.find('=') == std::string_view::npos) continue;
+
+      if (!run_segment(begin, i)) return false;
+
+      std::string error;
+      if (!evaluate(m_main, m_window[i], m_out, m_summary, error)) return stop(error);
+      m_version++;
+      begin = i + 1;
+    }
+
+    bool done = run_segment(begin, m_window.size());
+    m_window.clear();
+    return done;
+  }
+
+  bool BatchRunner::run_segment(std::size_t begin, std::size_t end) {
+    std::string error;
+
+    if (end - begin < parallel_lines) { // not worth waking the workers
+      for (std::size_t i = begin; i < end; i++)
+        if (!evaluate(m_main, m_window[i], m_out, m_summary, error)) return stop(error);
+      if (m_out.size() >= flush_threshold) flush();
+      return true;
+    }
+
+    // a few chunks per worker, so that workers finishing early have something to steal
+    const std::size_t count = std::min((end - begin) / parallel_lines, m_pool->size() * 8);
+    const std::size_t size = (end - begin + count - 1) / count;
+
+    m_chunks.clear();
+    for (std::size_t first = begin; first < end; first += size)
+      m_chunks.push_back({first, std::min(first + size, end), fmt::memory_buffer(), {}, {}});
+
+    for (Chunk& chunk : m_chunks) {
+      m_pool->submit([this, &chunk](std::size_t worker) {
+        Context& ctx = *m_workers[worker];
+        if (ctx.version != m_version) sync(ctx);
+
+        for (std::size_t i = chunk.begin; i < chunk.end; i++)
+          if (!evaluate(ctx, m_window[i], chunk.out, chunk.summary, chunk.error)) break;
+      });
+    }
+    m_pool->wait();
+
+    for (Chunk& chunk : m_chunks) { // in input order
+      m_out.append(chunk.out);
+      m_summary.lines += chunk.summary.lines;
+      m_summary.results += chunk.summary.results;
+      m_summary.errors += chunk.summary.errors;
+
+      if (!chunk.error.empty()) return stop(chunk.error);
+      if (m_out.size() >= flush_threshold) flush();
+    }
+    return true;
+  }
+
+  void BatchRunner::sync(Context& ctx) {
+    const sya::SymbolTable& shared = m_main.variables; // not written while workers run
+    for (std::size_t slot = 0; slot < shared.size(); slot++) {
+      if (shared.read_only(slot)) continue;
+
+      if (shared.defined(slot)) ctx.variables.set(shared.name(slot), shared.value(slot));
+      else ctx.variables.remove(shared.name(slot));
+    }
+    ctx.version = m_version;
+  }
+
+  void BatchRunner::flush() {
+    if (m_out.size() != 0) std::fwrite(m_out.data(), 1, m_out.size(), m_sink);
+    m_out.clear();
+    std::fflush(m_sink);
+  }
+
+  BatchSummary BatchRunner::run_file(const std::string& path) {
+    m_summary = {};
+    m_number = 0;
+
+#if defined(_WIN32)
+    std::ifstream file(path, std::ios::binary);
+    if (!file) throw std::runtime_error(fmt::format("Cannot open file: '{}'", path));
+
+    std::string content{std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    lines(content);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error(fmt::format("Cannot open file: '{}'", path));
+
+    struct stat info{};
+    if (::fstat(fd, &info) != 0) {
+      ::close(fd);
+      throw std::runtime_error(fmt::format("Cannot read file: '{}'", path));
+    }
+
+    if (!S_ISREG(info.st_mode)) { // pipes and devices can't be mapped
+      ::close(fd);
+      std::FILE* source = std::fopen(path.c_str(), "rb");
+      if (!source) throw std::runtime_error(fmt::format("Cannot open file: '{}'", path));
+      run_stream(source);
+      std::fclose(source);
+      return m_summary;
+    }
+
+    const auto size = static_cast<std::size_t>(info.st_size);
+    if (size != 0) {
+      void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data == MAP_FAILED) {
+        ::close(fd);
+        throw std::runtime_error(fmt::format("Cannot map file: '{}'", path));
+      }
+      ::madvise(data, size, MADV_SEQUENTIAL);
+
+      lines({static_cast<const char*>(data), size});
+      ::munmap(data, size);
+    }
+    ::close(fd);
+#endif
+
+    flush();
+    return m_summary;
+  }
+
+  BatchSummary BatchRunner::run_stream(std::FILE* source) {
+    m_summary = {};
+    m_number = 0;
+
+    std::vector<char> buffer(read_block);
+    std::size_t kept = 0; // bytes of an incomplete line carried over from the previous read
+
+    while (true) {
+      if (kept == buffer.size()) buffer.resize(buffer.size() * 2); // a line longer than the buffer
+
+      const std::size_t read = std::fread(buffer.data() + kept, 1, buffer.size() - kept, source);
+      if (read == 0) break;
+
+      std::string_view block(buffer.data(), kept + read);
+      const std::size_t last = block.rfind('\n');
+      if (last == std::string_view::npos) { // no complete line yet
+        kept = block.size();
+        continue;
+      }
+
+      if (!lines(block.substr(0, last + 1))) {
+        flush();
+        return m_summary;
+      }
+      kept = block.size() - last - 1;
+      std::copy(buffer.data() + last + 1, buffer.data() + block.size(), buffer.data());
+    }
+
+    if (kept != 0) lines({buffer.data(), kept}); // last line without a newline
+    flush();
+    return m_summary;
+  }
+}
@@ -0,0 +1,261 @@
+#include "bytecode.hpp"
+#include "stats.hpp"
+
+#include <array>     // for std::array
+#include <algorithm> // for std::find, std::find_if, std::max
+#include <cmath>     // for std::pow
+#include <fmt/core.h>
+
+namespace sya {
+  template <typename T>
+  [[nodiscard]] Result<BasicProgram<T>> try_compile(const Expression& rpn_expr) { // compile an RPN expression to a flat program
+    SYA_STATS_TIME(COMPILE);
+    using tt = TokenType;
+    using ec = ErrorCode;
+
+    BasicProgram<T> program;
+    std::vector<bool> assigned; // slots assigned so far, to tell inputs apart from outputs
+    std::size_t depth = 0; // stack depth simulated at compile time, so that evaluation needs no checks
+
+    program.code.reserve(rpn_expr.size());
+
+    auto emit = [&](OpCode op, std::size_t arg = 0, std::size_t arity = 0) {
+      program.code.push_back({op, static_cast<uint8_t>(arity), static_cast<uint32_t>(arg)});
+    };
+    auto slot_of = [&](const Token& token) -> std::size_t { // find or create the slot of a variable
+      auto it = std::find(program.names.begin(), program.names.end(), token.view());
+      if (it != program.names.end()) return static_cast<std::size_t>(it - program.names.begin());
+
+      program.names.emplace_back(token.view());
+      program.positions.push_back(token.position());
+      program.inputs.push_back(false);
+      program.outputs.push_back(false);
+      assigned.push_back(false);
+      return program.names.size() - 1;
+    };
+    auto error = [](ErrorCode code, const Token* token = nullptr) { // positioned on the token it's about
+      return std::unexpected(token ? Error{code, token->position(), token->view()} : Error{code});
+    };
+
+    for (size_t i = 0; i < rpn_expr.size(); i++) {
+      const Token& token = rpn_expr[i];
+      switch (token.type()) {
+        case tt::NUMBER: {
+          T value{};
+          std::errc parsed = utils::parse_number(token.view(), value); // decode the literal once
+          if (parsed == std::errc::result_out_of_range) return error(ec::NUMBER_OUT_OF_RANGE, &token);
+          if (parsed != std::errc()) return error(ec::INVALID_NUMBER, &token);
+
+          emit(OpCode::PUSH, program.literals.size());
+          program.literals.push_back(value);
+          depth++;
+          break;
+        }
+        case tt::OPERATOR: {
+          auto op = token.view();
+          if (op == "=") continue; // assignments are emitted by the variable preceding them
+
+          if (depth < 2) return error(ec::MISSING_OPERAND);
+          if (op == "+") emit(OpCode::ADD);
+          else if (op == "-") emit(OpCode::SUB);
+          else if (op == "*") emit(OpCode::MUL);
+          else if (op == "/") emit(OpCode::DIV);
+          else if (op == "^") emit(OpCode::POW);
+          else return error(ec::INVALID_OPERATOR, &token);
+          depth--;
+          break;
+        }
+        case tt::FUNCTION: {
+          auto fn = token.view();
+          const FunctionDef* def = find_function(fn);
+          if (!def) return error(ec::INVALID_FUNCTION, &token);
+          if (depth < def->arity) return error(ec::MISSING_ARGUMENTS, &token);
+
+          emit(OpCode::CALL, program.functions.size(), def->arity);
+          program.functions.push_back(resolve_function<T>(def->id)); // resolve the function once
+          program.calls.push_back(def->id);
+          depth = depth - def->arity + 1;
+          break;
+        }
+        case tt::VARIABLE: {
+          auto slot = slot_of(token);
+
+          if ((i + 1) < rpn_expr.size() && rpn_expr[i + 1].type() == tt::OPERATOR && rpn_expr[i + 1].view() == "=") {
+            if (depth == 0) return error(ec::MISSING_ASSIGNED_VALUE, &token);
+
+            emit(OpCode::STORE, slot);
+            assigned[slot] = true;
+            program.outputs[slot] = true;
+            program.assigns = true;
+          } else {
+            emit(OpCode::LOAD, slot);
+            if (!assigned[slot]) program.inputs[slot] = true;
+            depth++;
+          }
+          break;
+        }
+        default: return error(ec::INVALID_TOKEN);
+      }
+      program.depth = std::max(program.depth, depth);
+    }
+
+    if (!program.assigns && depth > 1) return error(ec::TOO_MANY_OPERANDS);
+    return program;
+  }
+
+  template <typename T>
+  [[nodiscard]] BasicProgram<T> compile(const Expression& rpn_expr) {
+    auto program = try_compile<T>(rpn_expr);
+    if (!program) raise(program.error());
+    return std::move(*program);
+  }
+
+  template <typename T>
+  [[nodiscard]] Result<std::optional<T>> try_evaluate(const BasicProgram<T>& program, std::span<double> slots) {
+    SYA_STATS_TIME(EVALUATE);
+    std::array<T, 64> buffer; // small programs evaluate on the native stack,
+    std::vector<T> heap;      // deeper ones fall back to the heap
+    T* stack = buffer.data();
+    if (program.depth > buffer.size()) {
+      heap.resize(program.depth);
+      stack = heap.data();
+    }
+
+    std::array<T, 16> temp_buffer; // temporaries hold shared subexpressions
+    std::vector<T> temp_heap;
+    T* temps = temp_buffer.data();
+    if (program.temps > temp_buffer.size()) {
+      temp_heap.resize(program.temps);
+      temps = temp_heap.data();
+    }
+
+    T* top = stack; // one past the top of the evaluation stack
+    const T* literals = program.literals.data();
+
+    for (const Instruction& in : program.code) {
+      switch (in.op) {
+        case OpCode::PUSH: *top++ = literals[in.arg]; break;
+        case OpCode::LOAD: *top++ = static_cast<T>(slots[in.arg]); break;
+        case OpCode::STORE: slots[in.arg] = static_cast<double>(top[-1]); break;
+        case OpCode::ADD: top[-2] = top[-2] + top[-1]; --top; break;
+        case OpCode::SUB: top[-2] = top[-2] - top[-1]; --top; break;
+        case OpCode::MUL: top[-2] = top[-2] * top[-1]; --top; break;
+        case OpCode::DIV: {
+          if (top[-1] == 0) return std::unexpected(Error{ErrorCode::DIVISION_BY_ZERO});
+          top[-2] = top[-2] / top[-1]; --top;
+          break;
+        }
+        case OpCode::POW: top[-2] = std::pow(top[-2], top[-1]); --top; break;
+        case OpCode::CALL: {
+          top -= in.arity; // arguments are laid out in call order on the stack
+          if (auto error = domain_error(program.calls[in.arg], top)) return std::unexpected(Error{*error}); // instead of the routine throwing
+          *top = program.functions[in.arg](top);
+          ++top;
+          break;
+        }
+        case OpCode::SAVE: temps[in.arg] = top[-1]; break;
+        case OpCode::RECALL: *top++ = temps[in.arg]; break;
+      }
+    }
+
+    // assignments produce no result, like in evaluate_rpn()
+    if (program.assigns || top == stack) return std::optional<T>();
+    return stack[0];
+  }
+
+  template <typename T>
+  [[nodiscard]] std::optional<T> evaluate(const BasicProgram<T>& program, std::span<double> slots) {
+    auto result = try_evaluate(program, slots);
+    if (!result) raise(result.error());
+    return *result;
+  }
+
+  template <typename T>
+  [[nodiscard]] std::optional<T> evaluate(const BasicProgram<T>& program, std::vector<Variable>& variables) {
+    if (!program.symbols.empty()) throw std::logic_error("Invalid program: program is bound to a symbol table");
+
+    std::vector<double> slots(program.names.size());
+
+    for (size_t s = 0; s < program.names.size(); s++) { // bind every slot once, instead of once per token
+      SYA_STATS_COUNT(VARIABLE_LOOKUPS);
+      auto it = std::find_if(variables.begin(), variables.end(), [&](const Variable& v) { return v.name == program.names[s]; });
+      if (it != variables.end()) slots[s] = it->value;
+      else if (program.inputs[s])
+        raise({ErrorCode::UNDEFINED_VARIABLE, 0, program.names[s]});
+    }
+
+    auto result = evaluate(program, slots);
+
+    if (program.assigns) { // write assigned slots back, in assignment order
+      for (const Instruction& in : program.code) {
+        if (in.op != OpCode::STORE) continue;
+
+        const auto& name = program.names[in.arg];
+        auto it = std::find_if(variables.begin(), variables.end(), [&](const Variable& v) { return v.name == name; });
+        if (it != variables.end()) it->value = slots[in.arg];
+        else variables.push_back({name, slots[in.arg]});
+      }
+    }
+    return result;
+  }
+
+  template <typename T>
+  void bind(BasicProgram<T>& program, SymbolTable& table) {
+    if (!program.symbols.empty()) throw std::logic_error("Invalid program: program is already bound");
+
+    program.symbols.reserve(program.names.size());
+    for (size_t s = 0; s < program.names.size(); s++) {
+      auto slot = table.intern(program.names[s]);
+      if (program.outputs[s] && table.read_only(slot))
+        throw std::logic_error(fmt::format("Cannot assign to reserved constant '{}'", program.names[s]));
+      program.symbols.push_back(slot);
+    }
+
+    for (Instruction& in : program.code) // relocate variable operands to table slots
+      if (in.op == OpCode::LOAD || in.op == OpCode::STORE) in.arg = static_cast<uint32_t>(program.symbols[in.arg]);
+  }
+
+  template <typename T>
+  [[nodiscard]] Result<std::optional<T>> try_evaluate(const BasicProgram<T>& program, SymbolTable& table) {
+    return evaluate_bound(program, table, [&](std::span<double> slots) { return try_evaluate(program, slots); });
+  }
+
+  template <typename T>
+  [[nodiscard]] std::optional<T> evaluate(const BasicProgram<T>& program, SymbolTable& table) {
+    auto result = try_evaluate(program, table);
+    if (!result) raise(result.error());
+    return *result;
+  }
+
+  template Result<BasicProgram<float>> try_compile<float>(const Expression&);
+  template Result<BasicProgram<double>> try_compile<double>(const Expression&);
+  template Result<BasicProgram<long double>> try_compile<long double>(const Expression&);
+
+  template BasicProgram<float> compile<float>(const Expression&);
+  template BasicProgram<double> compile<double>(const Expression&);
+  template BasicProgram<long double> compile<long double>(const Expression&);
+
+  template Result<std::optional<float>> try_evaluate<float>(const BasicProgram<float>&, std::span<double>);
+  template Result<std::optional<double>> try_evaluate<double>(const BasicProgram<double>&, std::span<double>);
+  template Result<std::optional<long double>> try_evaluate<long double>(const BasicProgram<long double>&, std::span<double>);
+
+  template std::optional<float> evaluate<float>(const BasicProgram<float>&, std::span<double>);
+  template std::optional<double> evaluate<double>(const BasicProgram<double>&, std::span<double>);
+  template std::optional<long double> evaluate<long double>(const BasicProgram<long double>&, std::span<double>);
+
+  template std::optional<float> evaluate<float>(const BasicProgram<float>&, std::vector<Variable>&);
+  template std::optional<double> evaluate<double>(const BasicProgram<double>&, std::vector<Variable>&);
+  template std::optional<long double> evaluate<long double>(const BasicProgram<long double>&, std::vector<Variable>&);
+
+  template void bind<float>(BasicProgram<float>&, SymbolTable&);
+  template void bind<double>(BasicProgram<double>&, SymbolTable&);
+  template void bind<long double>(BasicProgram<long double>&, SymbolTable&);
+
+  template Result<std::optional<float>> try_evaluate<float>(const BasicProgram<float>&, SymbolTable&);
+  template Result<std::optional<double>> try_evaluate<double>(const BasicProgram<double>&, SymbolTable&);
+  template Result<std::optional<long double>> try_evaluate<long double>(const BasicProgram<long double>&, SymbolTable&);
+
+  template std::optional<float> evaluate<float>(const BasicProgram<float>&, SymbolTable&);
+  template std::optional<double> evaluate<double>(const BasicProgram<double>&, SymbolTable&);
+  template std::optional<long double> evaluate<long double>(const BasicProgram<long double>&, SymbolTable&);
+}
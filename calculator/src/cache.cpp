@@ -0,0 +1,133 @@
+#include "cache.hpp"
+#include "engine.hpp"
+#include "optimize.hpp"
+#include "parser.hpp"
+
+namespace sya {
+  namespace {
+    // estimated memory held by a cache entry: its key, tokens and program
+    template <typename T>
+    std::size_t footprint(std::string_view key, const CompiledExpression<T>& value) {
+      std::size_t bytes = key.size() + sizeof(value);
+
+      for (const Token& token : value.rpn)
+        bytes += sizeof(Token) + (token.view().size() > 15 ? token.view().size() : 0); // longer values leave the inline buffer
+
+      const auto& p = value.program;
+      bytes += p.code.size() * sizeof(Instruction) + p.literals.size() * sizeof(T)
+             + p.functions.size() * (sizeof(FunctionPtr<T>) + sizeof(Function)) + p.symbols.size() * sizeof(std::size_t)
+             + p.positions.size() * sizeof(uint32_t);
+      for (const auto& name : p.names) bytes += sizeof(name) + name.size();
+      return bytes;
+    }
+  }
+
+  template <typename T>
+  [[nodiscard]] Result<const CompiledExpression<T>*> BasicExpressionCache<T>::try_get(std::string_view expr, SymbolTable& table) {
+    if (m_table != &table) { // programs are bound to slots of one table
+      clear();
+      m_table = &table;
+    }
+
+    if (auto it = m_index.find(expr); it != m_index.end()) {
+      m_stats.hits++;
+      m_entries.splice(m_entries.begin(), m_entries, it->second); // mark as most recently used
+      return &it->second->value;
+    }
+    m_stats.misses++;
+
+    CompiledExpression<T> value; // compile first, so that nothing is cached for invalid expressions
+    {
+      Scratch& scratch = thread_scratch();
+      const ArenaScope scope(scratch.arena);
+      auto rpn = try_parse(expr, scratch.arena.resource());
+      if (!rpn) return std::unexpected(rpn.error());
+      value.rpn = std::move(*rpn); // moved out of the arena, into the entry's own memory
+    }
+    fold_constants<T>(value.rpn); // cached expressions are evaluated many times, fold them once
+    auto program = try_compile<T>(value.rpn);
+    if (!program) return std::unexpected(locate(program.error(), expr)); // the tokens are about to go
+    value.program = std::move(*program);
+    bind(value.program, table);
+
+    std::size_t bytes = footprint(expr, value);
+    m_entries.push_front({std::string(expr), std::move(value), bytes});
+    m_index.emplace(m_entries.front().key, m_entries.begin());
+    m_stats.bytes += bytes;
+
+    evict();
+    return &m_entries.front().value;
+  }
+
+  template <typename T>
+  const CompiledExpression<T>& BasicExpressionCache<T>::get(std::string_view expr, SymbolTable& table) {
+    auto compiled = try_get(expr, table);
+    if (!compiled) raise(compiled.error());
+    return **compiled;
+  }
+
+  template <typename T>
+  void BasicExpressionCache<T>::insert(std::string_view expr, CompiledExpression<T> value, const SymbolTable& table) {
+    if (m_table != &table) {
+      clear();
+      m_table = &table;
+    }
+    if (m_index.contains(expr)) return;
+
+    std::size_t bytes = footprint(expr, value);
+    m_entries.push_front({std::string(expr), std::move(value), bytes});
+    m_index.emplace(m_entries.front().key, m_entries.begin());
+    m_stats.bytes += bytes;
+    evict();
+  }
+
+  template <typename T>
+  [[nodiscard]] std::vector<std::pair<std::string_view, const CompiledExpression<T>*>> BasicExpressionCache<T>::entries() const {
+    std::vector<std::pair<std::string_view, const CompiledExpression<T>*>> out;
+    out.reserve(m_entries.size());
+    for (auto it = m_entries.rbegin(); it != m_entries.rend(); ++it) out.emplace_back(it->key, &it->value);
+    return out;
+  }
+
+  template <typename T>
+  void BasicExpressionCache<T>::evict() {
+    // the most recent entry is always kept, even if it's larger than the byte limit on its own
+    while (m_entries.size() > 1 && (m_entries.size() > m_max_entries || m_stats.bytes > m_max_bytes)) {
+      const Entry& last = m_entries.back();
+      m_stats.bytes -= last.bytes;
+      m_stats.evictions++;
+      m_index.erase(last.key);
+      m_entries.pop_back();
+    }
+  }
+
+  template <typename T>
+  void BasicExpressionCache<T>::set_limits(std::size_t max_entries, std::size_t max_bytes) {
+    m_max_entries = max_entries;
+    m_max_bytes = max_bytes;
+    evict();
+  }
+
+  template <typename T>
+  void BasicExpressionCache<T>::clear() noexcept {
+    m_index.clear();
+    m_entries.clear();
+    m_stats.bytes = 0;
+  }
+
+  template <typename T>
+  void BasicExpressionCache<T>::reset_stats() noexcept {
+    m_stats.hits = m_stats.misses = m_stats.evictions = 0;
+  }
+
+  template <typename T>
+  [[nodiscard]] CacheStats BasicExpressionCache<T>::stats() const noexcept {
+    CacheStats s = m_stats;
+    s.entries = m_entries.size();
+    return s;
+  }
+
+  template class BasicExpressionCache<float>;
+  template class BasicExpressionCache<double>;
+  template class BasicExpressionCache<long double>;
+}
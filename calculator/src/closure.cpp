@@ -0,0 +1,230 @@
+#include "closure.hpp"
+#include "stats.hpp"
+
+#include <algorithm> // for std::max
+#include <array>     // for std::array
+#include <cmath>     // for std::pow
+#include <type_traits> // for std::is_same_v
+
+namespace sya {
+  namespace { // node routines, children are evaluated left first like in the interpreter, so they fail first the same way
+    template <typename T> using Node = typename BasicClosureTree<T>::Node;
+    template <typename T> using Context = typename BasicClosureTree<T>::Context;
+
+    template <typename N, typename C>
+    auto eval(const N* node, const C& ctx) { return node->eval(*node, ctx); }
+
+    // record the first error, the interpreter would have stopped there
+    template <typename C>
+    bool fail(const C& ctx, ErrorCode code) {
+      if (!*ctx.error) *ctx.error = code;
+      return true;
+    }
+
+    struct Add { template <typename T> static T apply(T l, T r) { return l + r; } };
+    struct Sub { template <typename T> static T apply(T l, T r) { return l - r; } };
+    struct Mul { template <typename T> static T apply(T l, T r) { return l * r; } };
+    struct Div { template <typename T> static T apply(T l, T r) { return l / r; } };
+    struct Pow { template <typename T> static T apply(T l, T r) { return std::pow(l, r); } };
+
+    template <typename T> T literal(const Node<T>& n, const Context<T>&) { return n.value; }
+    template <typename T> T variable(const Node<T>& n, const Context<T>& ctx) { return static_cast<T>(ctx.slots[n.index]); }
+
+    template <typename T, typename Op>
+    T binary(const Node<T>& n, const Context<T>& ctx) {
+      T left = eval(n.left, ctx); // sequenced, the left operand fails first
+      T right = eval(n.right, ctx);
+      if (std::is_same_v<Op, Div> && right == 0 && fail(ctx, ErrorCode::DIVISION_BY_ZERO)) return T{};
+      return Op::template apply<T>(left, right);
+    }
+    template <typename T, typename Op> // variable op literal, never a division by a zero literal
+    T var_lit(const Node<T>& n, const Context<T>& ctx) { return Op::template apply<T>(static_cast<T>(ctx.slots[n.index]), n.value); }
+    template <typename T, typename Op> // literal op variable
+    T lit_var(const Node<T>& n, const Context<T>& ctx) {
+      const T right = static_cast<T>(ctx.slots[n.index]);
+      if (std::is_same_v<Op, Div> && right == 0 && fail(ctx, ErrorCode::DIVISION_BY_ZERO)) return T{};
+      return Op::template apply<T>(n.value, right);
+    }
+
+    template <typename T>
+    T call1(const Node<T>& n, const Context<T>& ctx) {
+      const T args[1] = { eval(n.left, ctx) };
+      if (*ctx.error) return T{}; // the arguments may be anything past a failure
+      if (auto error = domain_error(n.call, args); error && fail(ctx, *error)) return T{}; // instead of the routine throwing
+      return n.fn(args);
+    }
+    template <typename T>
+    T call2(const Node<T>& n, const Context<T>& ctx) {
+      T args[2];
+      args[0] = eval(n.left, ctx);
+      args[1] = eval(n.right, ctx);
+      if (*ctx.error) return T{};
+      if (auto error = domain_error(n.call, args); error && fail(ctx, *error)) return T{};
+      return n.fn(args);
+    }
+
+    template <typename T>
+    T store(const Node<T>& n, const Context<T>& ctx) {
+      T value = eval(n.left, ctx);
+      if (!*ctx.error) ctx.slots[n.index] = static_cast<double>(value); // the interpreter stops before the store
+      return value;
+    }
+    template <typename T>
+    T save(const Node<T>& n, const Context<T>& ctx) { return ctx.temps[n.index] = eval(n.left, ctx); }
+    template <typename T>
+    T recall(const Node<T>& n, const Context<T>& ctx) { return ctx.temps[n.index]; }
+
+    // the routine of an operator node, specialized when one operand is a literal and the other a variable
+    template <typename T, typename Op>
+    void bind_binary(Node<T>& node, const Node<T>* left, const Node<T>* right) {
+      const bool zero_divisor = std::is_same_v<Op, Div> && right->eval == &literal<T> && right->value == 0;
+
+      if (left->eval == &variable<T> && right->eval == &literal<T> && !zero_divisor) {
+        node.eval = &var_lit<T, Op>;
+        node.index = left->index;
+        node.value = right->value;
+      } else if (left->eval == &literal<T> && right->eval == &variable<T>) {
+        node.eval = &lit_var<T, Op>;
+        node.value = left->value;
+        node.index = right->index;
+      } else {
+        node.eval = &binary<T, Op>;
+        node.left = left;
+        node.right = right;
+      }
+    }
+  }
+
+  template <typename T>
+  BasicClosureTree<T>::BasicClosureTree(BasicProgram<T> program) : m_program(std::move(program)) {
+    std::vector<const Node*> stack;
+    std::vector<std::size_t> depths; // height of the subtree of each stack entry
+    m_nodes.reserve(m_program.code.size()); // one node per instruction at most, so it never reallocates
+
+    for (const Instruction& in : m_program.code) {
+      Node node{};
+      std::size_t depth = 1;
+
+      switch (in.op) {
+        case OpCode::PUSH: node.eval = &literal<T>; node.value = m_program.literals[in.arg]; break;
+        case OpCode::LOAD: node.eval = &variable<T>; node.index = in.arg; break;
+        case OpCode::RECALL: node.eval = &recall<T>; node.index = in.arg; break;
+        case OpCode::STORE: case OpCode::SAVE: {
+          node.eval = in.op == OpCode::STORE ? &store<T> : &save<T>;
+          node.index = in.arg;
+          node.left = stack.back();
+          depth += depths.back();
+          stack.pop_back();
+          depths.pop_back();
+          break;
+        }
+        case OpCode::ADD: case OpCode::SUB: case OpCode::MUL: case OpCode::DIV: case OpCode::POW: {
+          const Node* right = stack.back();
+          const Node* left = stack[stack.size() - 2];
+          depth += std::max(depths.back(), depths[depths.size() - 2]);
+          stack.resize(stack.size() - 2);
+          depths.resize(depths.size() - 2);
+
+          switch (in.op) {
+            case OpCode::ADD: bind_binary<T, Add>(node, left, right); break;
+            case OpCode::SUB: bind_binary<T, Sub>(node, left, right); break;
+            case OpCode::MUL: bind_binary<T, Mul>(node, left, right); break;
+            case OpCode::DIV: bind_binary<T, Div>(node, left, right); break;
+            default: bind_binary<T, Pow>(node, left, right); break;
+          }
+          break;
+        }
+        case OpCode::CALL: {
+          if (in.arity < 1 || in.arity > 2) return; // no such function today, interpreted
+
+          node.eval = in.arity == 1 ? &call1<T> : &call2<T>;
+          node.fn = m_program.functions[in.arg];
+          node.call = m_program.calls[in.arg];
+          node.left = stack[stack.size() - in.arity];
+          if (in.arity == 2) node.right = stack.back();
+          for (std::size_t k = 0; k < in.arity; k++) {
+            depth = std::max(depth, depths.back() + 1);
+            stack.pop_back();
+            depths.pop_back();
+          }
+          break;
+        }
+      }
+
+      if (depth > max_depth) { // evaluation recurses once per level, leave deep trees to the interpreter
+        m_nodes.clear();
+        return;
+      }
+      m_nodes.push_back(node);
+      stack.push_back(&m_nodes.back());
+      depths.push_back(depth);
+    }
+
+    m_roots = std::move(stack);
+  }
+
+  template <typename T>
+  [[nodiscard]] Result<std::optional<T>> BasicClosureTree<T>::try_evaluate(std::span<double> slots) const {
+    if (m_roots.empty()) return sya::try_evaluate(m_program, slots);
+    SYA_STATS_TIME(EVALUATE);
+
+    std::array<T, 16> temp_buffer; // same temporaries as the interpreter
+    std::vector<T> temp_heap;
+    T* temps = temp_buffer.data();
+    if (m_program.temps > temp_buffer.size()) {
+      temp_heap.resize(m_program.temps);
+      temps = temp_heap.data();
+    }
+
+    std::optional<ErrorCode> error;
+    const Context ctx{slots.data(), temps, &error};
+    T result{};
+    for (const Node* root : m_roots) {
+      result = eval(root, ctx);
+      if (error) return std::unexpected(Error{*error});
+    }
+
+    if (m_program.assigns) return std::optional<T>();
+    return result;
+  }
+
+  template <typename T>
+  [[nodiscard]] std::optional<T> BasicClosureTree<T>::evaluate(std::span<double> slots) const {
+    auto result = try_evaluate(slots);
+    if (!result) raise(result.error());
+    return *result;
+  }
+
+  template <typename T>
+  [[nodiscard]] BasicClosureTree<T> closure_compile(const Expression& rpn_expr) {
+    return BasicClosureTree<T>(compile<T>(rpn_expr));
+  }
+
+  template <typename T>
+  [[nodiscard]] Result<std::optional<T>> try_evaluate(const BasicClosureTree<T>& tree, SymbolTable& table) {
+    return evaluate_bound(tree.program(), table, [&](std::span<double> slots) { return tree.try_evaluate(slots); });
+  }
+
+  template <typename T>
+  [[nodiscard]] std::optional<T> evaluate(const BasicClosureTree<T>& tree, SymbolTable& table) {
+    auto result = try_evaluate(tree, table);
+    if (!result) raise(result.error());
+    return *result;
+  }
+
+  template class BasicClosureTree<float>;
+  template class BasicClosureTree<double>;
+  template class BasicClosureTree<long double>;
+
+  template BasicClosureTree<float> closure_compile<float>(const Expression&);
+  template BasicClosureTree<double> closure_compile<double>(const Expression&);
+  template BasicClosureTree<long double> closure_compile<long double>(const Expression&);
+
+  template Result<std::optional<float>> try_evaluate<float>(const BasicClosureTree<float>&, SymbolTable&);
+  template Result<std::optional<double>> try_evaluate<double>(const BasicClosureTree<double>&, SymbolTable&);
+  template Result<std::optional<long double>> try_evaluate<long double>(const BasicClosureTree<long double>&, SymbolTable&);
+
+  template std::optional<float> evaluate<float>(const BasicClosureTree<float>&, SymbolTable&);
+  template std::optional<double> evaluate<double>(const BasicClosureTree<double>&, SymbolTable&);
+  template std::optional<long double> evaluate<long double>(const BasicClosureTree<long double>&, SymbolTable&);
+}
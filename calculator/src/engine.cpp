@@ -0,0 +1,68 @@
+#include "engine.hpp"
+#include "optimize.hpp"
+#include "parser.hpp"
+
+namespace sya {
+  [[nodiscard]] Scratch& thread_scratch() noexcept {
+    thread_local Scratch scratch;
+    return scratch;
+  }
+
+  [[nodiscard]] const Engine& Engine::shared() noexcept {
+    static constexpr Engine engine;
+    return engine;
+  }
+
+  template <typename T>
+  [[nodiscard]] Result<BasicProgram<T>> Engine::try_compile(std::string_view expr, Scratch& scratch) const {
+    const ArenaScope scope(scratch.arena); // declared first, so the RPN is gone when it resets
+    auto rpn = try_parse(expr, scratch.arena.resource()); // one pass, no token vector
+    if (!rpn) return std::unexpected(rpn.error());
+
+    fold_constants<T>(*rpn);
+    auto program = sya::try_compile<T>(*rpn); // the program owns its memory, it outlives the arena
+    if (!program) return std::unexpected(locate(program.error(), expr));
+    return program;
+  }
+
+  template <typename T>
+  [[nodiscard]] BasicProgram<T> Engine::compile(std::string_view expr, Scratch& scratch) const {
+    auto program = try_compile<T>(expr, scratch);
+    if (!program) raise(program.error());
+    return std::move(*program);
+  }
+
+  template <typename T>
+  [[nodiscard]] Result<std::optional<T>> Engine::try_evaluate(std::string_view expr, SymbolTable& table, Scratch& scratch) const {
+    auto program = try_compile<T>(expr, scratch);
+    if (!program) return std::unexpected(program.error());
+    bind(*program, table);
+
+    auto result = sya::try_evaluate(*program, table);
+    if (!result) return std::unexpected(locate(result.error(), expr)); // the program and its names are about to go
+    return result;
+  }
+
+  template <typename T>
+  std::optional<T> Engine::evaluate(std::string_view expr, SymbolTable& table, Scratch& scratch) const {
+    auto result = try_evaluate<T>(expr, table, scratch);
+    if (!result) raise(result.error());
+    return *result;
+  }
+
+  template Result<BasicProgram<float>> Engine::try_compile<float>(std::string_view, Scratch&) const;
+  template Result<BasicProgram<double>> Engine::try_compile<double>(std::string_view, Scratch&) const;
+  template Result<BasicProgram<long double>> Engine::try_compile<long double>(std::string_view, Scratch&) const;
+
+  template BasicProgram<float> Engine::compile<float>(std::string_view, Scratch&) const;
+  template BasicProgram<double> Engine::compile<double>(std::string_view, Scratch&) const;
+  template BasicProgram<long double> Engine::compile<long double>(std::string_view, Scratch&) const;
+
+  template Result<std::optional<float>> Engine::try_evaluate<float>(std::string_view, SymbolTable&, Scratch&) const;
+  template Result<std::optional<double>> Engine::try_evaluate<double>(std::string_view, SymbolTable&, Scratch&) const;
+  template Result<std::optional<long double>> Engine::try_evaluate<long double>(std::string_view, SymbolTable&, Scratch&) const;
+
+  template std::optional<float> Engine::evaluate<float>(std::string_view, SymbolTable&, Scratch&) const;
+  template std::optional<double> Engine::evaluate<double>(std::string_view, SymbolTable&, Scratch&) const;
+  template std::optional<long double> Engine::evaluate<long double>(std::string_view, SymbolTable&, Scratch&) const;
+}
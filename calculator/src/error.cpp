@@ -0,0 +1,79 @@
+#include "error.hpp"
+#include "utils.hpp"
+
+#include <stdexcept> // for std::runtime_error, std::logic_error, std::out_of_range, std::invalid_argument
+#include <fmt/core.h>
+
+namespace sya {
+  [[nodiscard]] std::string Error::message() const {
+    using ec = ErrorCode;
+    const char c = text.empty() ? '\0' : text.front();
+
+    switch (code) {
+      case ec::EMPTY_EXPRESSION: return "Empty expression";
+      case ec::INVALID_CHARACTER: return fmt::format("Invalid character '{}' at position {}", c, position);
+      case ec::WHITESPACE_IN_NUMBER: return fmt::format("Invalid expression: unexpected whitespace in number at position {}", position);
+      case ec::MULTIPLE_DECIMAL_POINTS: return fmt::format("Invalid number: multipe decimal points at position {}", position);
+      case ec::EMPTY_PARENTHESES: return fmt::format("Invalid expression: empty parentheses at position {}", position);
+      case ec::UNEXPECTED_CLOSING_PARENT: return fmt::format("Invalid expression: Unexpected closing parenthesis at position {}", position);
+      case ec::MISSING_CLOSING_PARENT: return fmt::format("Mismatched parentheses: missing {} closing parenthesis", got);
+      case ec::UNEXPECTED_AFTER_UNARY:
+        return fmt::format("Invalid expression: unexpected {} after unary operator at position {}",
+                           utils::is_space(c) ? "[SPACE]" : std::to_string(static_cast<unsigned char>(c)), position);
+      case ec::DOUBLE_UNARY: return fmt::format("Invalid expression: unexpected unary operator '{}' after unary operator at position {}", c, position);
+      case ec::DOUBLE_OPERATOR: return fmt::format("Invalid expression: unexpected operator '{}' after operator at position {}", c, position);
+      case ec::MISPLACED_SEPARATOR: return fmt::format("Invalid separator: unexpected separator at position {}", position);
+      case ec::ASSIGNMENT_TO_VALUE: return fmt::format("Invalid expression: unexpected assignment operator at position {}", position);
+      case ec::ASSIGNMENT_TO_FUNCTION:
+        return fmt::format("Invalid expression: unexpected assignment operator after function name at position {}", position);
+      case ec::ASSIGNMENT_TO_CONSTANT:
+        return fmt::format("Invalid expression: unexpected assignment operator after reserved constant name at position {}", position);
+
+      case ec::OPERATOR_AT_BOUNDARY: return "Invalid expression: unexpected operator at the start/end of the expression";
+      case ec::MISSING_OPERAND: return "Invalid expression: insufficient operands for binary operator";
+      case ec::TOO_MANY_OPERANDS: return "Invalid expression: too many operands left after evaluation";
+      case ec::SEPARATOR_OUTSIDE_FUNCTION: return "Invalid function: separator outside function";
+      case ec::MISMATCHED_PARENTHESES: return "Invalid expression: mismatched parentheses";
+      case ec::ARGUMENT_COUNT:
+        return fmt::format("Invalid function: argument count mismatch for {}(). Expected {}, got {}", text, expected, got);
+      case ec::INVALID_TOKEN: return "Invalid token: unsupported token type";
+      case ec::INVALID_ASSIGNMENT: return "Invalid assignment: cannot assign to an expression, only to variables";
+
+      case ec::MISSING_ARGUMENTS: return fmt::format("Invalid expression: insufficient arguments for function {}()", text);
+      case ec::MISSING_ASSIGNED_VALUE: return fmt::format("Invalid expression: missing value for variable assignment to '{}'", text);
+      case ec::INVALID_OPERATOR: return fmt::format("Invalid operator: {}", text);
+      case ec::INVALID_FUNCTION: return fmt::format("Invalid function: {}", text);
+      case ec::NUMBER_OUT_OF_RANGE: return fmt::format("Number out of range: {}", text);
+      case ec::INVALID_NUMBER: return fmt::format("Invalid number: {}", text);
+
+      case ec::UNDEFINED_VARIABLE: return fmt::format("Undefined variable: '{}'", text);
+      case ec::DIVISION_BY_ZERO: return "Division by zero";
+      case ec::LOG_DOMAIN: return "Logarithm of non-positive number";
+      case ec::ACOSH_DOMAIN: return "Inverse hyperbolic cosine of number less than 1";
+      case ec::ATANH_DOMAIN: return "Inverse hyperbolic tangent of number outside the range (-1, 1)";
+    }
+    return "Unknown error";
+  }
+
+  void raise(const Error& error) {
+    using ec = ErrorCode;
+
+    // the exception types the lexer, the converter and the number parser have always thrown
+    if (error.code <= ec::ASSIGNMENT_TO_CONSTANT || error.code == ec::OPERATOR_AT_BOUNDARY)
+      throw std::runtime_error(error.message());
+    if (error.code == ec::NUMBER_OUT_OF_RANGE) throw std::out_of_range(error.message());
+    if (error.code == ec::INVALID_NUMBER) throw std::invalid_argument(error.message());
+    throw std::logic_error(error.message());
+  }
+
+  [[nodiscard]] Error locate(Error error, std::string_view source) noexcept {
+    if (error.text.empty()) return error;
+
+    // the position recorded by the lexer, carried by the tokens and the program's slots
+    const std::size_t at = error.position - 1;
+    if (error.position != 0 && at <= source.size() && source.substr(at, error.text.size()) == error.text)
+      error.text = source.substr(at, error.text.size());
+    else error.text = {}; // like a folded literal, not in the source
+    return error;
+  }
+}
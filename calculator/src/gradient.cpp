@@ -0,0 +1,118 @@
+#include "gradient.hpp"
+#include "error.hpp"
+#include "operator.hpp"
+#include "stats.hpp"
+
+#include <algorithm> // for std::find, std::find_if, std::fill_n, std::copy_n, std::max
+#include <cmath>     // for std::pow, std::log
+#include <stdexcept> // for std::logic_error
+#include <fmt/core.h>
+
+namespace sya {
+  template <typename T>
+  [[nodiscard]] BasicGradient<T> evaluate_gradient(const Expression& rpn_expr, std::span<const std::string_view> wrt,
+                                                   const std::vector<Variable>& variables) {
+    return evaluate_gradient(compile<T>(rpn_expr), wrt, variables);
+  }
+
+  template <typename T>
+  [[nodiscard]] BasicGradient<T> evaluate_gradient(const BasicProgram<T>& program, std::span<const std::string_view> wrt,
+                                                   const std::vector<Variable>& variables) {
+    SYA_STATS_TIME(EVALUATE);
+
+    if (program.assigns) throw std::logic_error("Invalid gradient: assignments are not supported in gradient evaluation");
+    if (!program.symbols.empty()) throw std::logic_error("Invalid program: program is bound to a symbol table");
+
+    const std::size_t n = wrt.size();
+    const std::size_t width = n + 1; // a value and its tangents
+
+    // the row each slot is loaded as, its value then a 1 at the tangent of its variable of `wrt`, if any
+    std::vector<T> seeds(program.names.size() * width, T{});
+    for (std::size_t s = 0; s < program.names.size(); s++) {
+      const auto& name = program.names[s];
+      auto it = std::find_if(variables.begin(), variables.end(), [&](const Variable& v) { return v.name == name; });
+      if (it == variables.end())
+        throw std::logic_error(fmt::format("Undefined variable: '{}'", name));
+
+      T* seed = seeds.data() + s * width;
+      seed[0] = static_cast<T>(it->value);
+      auto var = std::find(wrt.begin(), wrt.end(), name);
+      if (var != wrt.end()) seed[1 + (var - wrt.begin())] = 1;
+    }
+
+    std::vector<T> stack(std::max<std::size_t>(program.depth, 1) * width);
+    std::vector<T> temps(program.temps * width);
+    T* top = stack.data(); // start of the row past the top of the stack
+
+    // the two top rows, the result replaces the left one
+    auto binary = [&](auto op) {
+      T* a = top - 2 * width;
+      const T* b = top - width;
+      op(a, b);
+      top -= width;
+    };
+
+    for (const Instruction& in : program.code) {
+      switch (in.op) {
+        case OpCode::PUSH: top[0] = program.literals[in.arg]; std::fill_n(top + 1, n, T{0}); top += width; break;
+        case OpCode::LOAD: std::copy_n(seeds.data() + in.arg * width, width, top); top += width; break;
+        case OpCode::STORE: break; // rejected above
+        case OpCode::ADD: binary([&](T* a, const T* b) { for (std::size_t k = 0; k < width; k++) a[k] += b[k]; }); break;
+        case OpCode::SUB: binary([&](T* a, const T* b) { for (std::size_t k = 0; k < width; k++) a[k] -= b[k]; }); break;
+        case OpCode::MUL: binary([&](T* a, const T* b) {
+          const T u = a[0], v = b[0];
+          for (std::size_t k = 1; k < width; k++) a[k] = a[k] * v + u * b[k];
+          a[0] = u * v;
+        }); break;
+        case OpCode::DIV: binary([&](T* a, const T* b) {
+          const T v = b[0];
+          if (v == 0) raise({ErrorCode::DIVISION_BY_ZERO});
+          const T q = a[0] / v;
+          for (std::size_t k = 1; k < width; k++) a[k] = (a[k] - q * b[k]) / v;
+          a[0] = q;
+        }); break;
+        case OpCode::POW: binary([&](T* a, const T* b) {
+          const T args[2] = {a[0], b[0]};
+          T partials[2];
+          const T value = std::pow(args[0], args[1]);
+          resolve_derivative<T>(Function::POW)(args, value, partials);
+          // a constant exponent leaves the (possibly NaN) partial of the exponent out
+          for (std::size_t k = 1; k < width; k++)
+            a[k] = partials[0] * a[k] + (b[k] == 0 ? T{0} : partials[1] * b[k]);
+          a[0] = value;
+        }); break;
+        case OpCode::CALL: {
+          T* first = top - in.arity * width; // row of the first argument, receives the result
+          T args[8], partials[8]; // no function takes more arguments
+          for (std::size_t j = 0; j < in.arity; j++) args[j] = first[j * width];
+
+          const T value = program.functions[in.arg](args);
+          resolve_derivative<T>(program.calls[in.arg])(args, value, partials);
+
+          // chain rule over every tangent, the first argument's row is overwritten in place
+          for (std::size_t k = 1; k < width; k++) first[k] = first[k] == 0 ? T{0} : partials[0] * first[k];
+          for (std::size_t j = 1; j < in.arity; j++) {
+            const T* arg = first + j * width;
+            for (std::size_t k = 1; k < width; k++) first[k] += arg[k] == 0 ? T{0} : partials[j] * arg[k];
+          }
+          first[0] = value;
+          top = first + width;
+          break;
+        }
+        case OpCode::SAVE: std::copy_n(top - width, width, temps.data() + in.arg * width); break;
+        case OpCode::RECALL: std::copy_n(temps.data() + in.arg * width, width, top); top += width; break;
+      }
+    }
+
+    return {stack[0], std::vector<T>(stack.begin() + 1, stack.begin() + static_cast<std::ptrdiff_t>(width))};
+  }
+
+  template BasicGradient<float> evaluate_gradient<float>(const Expression&, std::span<const std::string_view>, const std::vector<Variable>&);
+  template BasicGradient<double> evaluate_gradient<double>(const Expression&, std::span<const std::string_view>, const std::vector<Variable>&);
+  template BasicGradient<long double> evaluate_gradient<long double>(const Expression&, std::span<const std::string_view>, const std::vector<Variable>&);
+
+  template BasicGradient<float> evaluate_gradient<float>(const BasicProgram<float>&, std::span<const std::string_view>, const std::vector<Variable>&);
+  template BasicGradient<double> evaluate_gradient<double>(const BasicProgram<double>&, std::span<const std::string_view>, const std::vector<Variable>&);
+  template BasicGradient<long double> evaluate_gradient<long double>(const BasicProgram<long double>&, std::span<const std::string_view>,
+                                                                     const std::vector<Variable>&);
+}
@@ -0,0 +1,117 @@
+#include "history.hpp"
+
+#include <algorithm> // for std::min
+#include <utility>   // for std::move
+
+namespace console {
+  namespace {
+    constexpr std::size_t text_overhead = sizeof(std::string) + 48; // the index node and reference count of a text
+  }
+
+  uint32_t HistoryStore::intern(std::string_view expression) {
+    if (auto it = m_index.find(expression); it != m_index.end()) {
+      m_refs[it->second]++;
+      return it->second;
+    }
+
+    uint32_t text;
+    if (!m_free.empty()) {
+      text = m_free.back();
+      m_free.pop_back();
+      m_texts[text] = expression;
+      m_refs[text] = 1;
+    } else {
+      text = static_cast<uint32_t>(m_texts.size());
+      m_texts.emplace_back(expression);
+      m_refs.push_back(1);
+    }
+    m_index.emplace(m_texts[text], text);
+    m_bytes += expression.size() + text_overhead;
+    return text;
+  }
+
+  void HistoryStore::release(uint32_t text) {
+    if (--m_refs[text] != 0) return;
+
+    m_bytes -= m_texts[text].size() + text_overhead;
+    m_index.erase(m_texts[text]);
+    std::string().swap(m_texts[text]); // give its memory back
+    m_free.push_back(text);
+  }
+
+  void HistoryStore::pop() {
+    release(record(0).text);
+    m_first = (m_first + 1) & (m_ring.size() - 1);
+    m_count--;
+    m_bytes -= sizeof(Record);
+  }
+
+  void HistoryStore::evict() {
+    while (m_count > 1 && m_bytes > m_max_bytes) pop(); // the newest entry is always kept
+  }
+
+  std::size_t HistoryStore::add(std::string_view expression, double result) {
+    const std::size_t id = m_next;
+    add(id, expression, result);
+    return id;
+  }
+
+  void HistoryStore::add(std::size_t id, std::string_view expression, double result) {
+    if (m_count == m_ring.size()) { // full, grow and unwrap the ring
+      std::vector<Record> ring(m_ring.empty() ? 16 : m_ring.size() * 2);
+      for (std::size_t i = 0; i < m_count; i++) ring[i] = record(i);
+      m_ring = std::move(ring);
+      m_first = 0;
+    }
+
+    m_ring[(m_first + m_count) & (m_ring.size() - 1)] = {id, intern(expression), result};
+    m_count++;
+    m_bytes += sizeof(Record);
+    m_next = id + 1;
+    evict();
+  }
+
+  [[nodiscard]] HistoryEntry HistoryStore::operator[](std::size_t i) const noexcept {
+    const Record& r = record(i);
+    return {r.id, m_texts[r.text], r.result};
+  }
+
+  [[nodiscard]] std::vector<HistoryEntry> HistoryStore::last(std::size_t n) const {
+    n = std::min(n, m_count);
+    std::vector<HistoryEntry> entries;
+    entries.reserve(n);
+    for (std::size_t i = m_count - n; i < m_count; i++) entries.push_back((*this)[i]);
+    return entries;
+  }
+
+  [[nodiscard]] std::vector<HistoryEntry> HistoryStore::grep(std::string_view pattern) const {
+    std::vector<bool> matches(m_texts.size(), false); // each distinct expression is searched once
+    bool any = false;
+    for (std::size_t t = 0; t < m_texts.size(); t++) {
+      matches[t] = m_refs[t] != 0 && m_texts[t].find(pattern) != std::string::npos;
+      any |= matches[t];
+    }
+
+    std::vector<HistoryEntry> entries;
+    if (!any) return entries;
+    for (std::size_t i = 0; i < m_count; i++)
+      if (matches[record(i).text]) entries.push_back((*this)[i]);
+    return entries;
+  }
+
+  void HistoryStore::set_limit(std::size_t max_bytes) {
+    m_max_bytes = max_bytes;
+    evict();
+  }
+
+  void HistoryStore::clear() noexcept {
+    m_ring.clear();
+    m_first = m_count = 0;
+    m_texts.clear();
+    m_refs.clear();
+    m_free.clear();
+    m_index.clear();
+    m_bytes = 0;
+    m_next = 1;
+  }
+}
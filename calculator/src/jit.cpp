@@ -0,0 +1,334 @@
+#include "jit.hpp"
+#include "stats.hpp"
+
+#include <array>     // for std::array
+#include <cmath>     // for std::pow
+#include <cstddef>   // for offsetof
+#include <cstdint>   // for std::uint8_t, std::int32_t, std::uint64_t
+#include <cstring>   // for std::memcpy
+#include <exception> // for std::exception_ptr, std::rethrow_exception
+#include <optional>  // for std::optional
+#include <type_traits> // for std::is_same_v
+#include <utility>   // for std::exchange
+#include <vector>    // for std::vector
+
+#if (defined(__x86_64__) || defined(_M_X64)) && !defined(_WIN32)
+#define SYA_JIT_X86_64 // System V ABI, mmap'd buffers
+#include <sys/mman.h> // for mmap, mprotect, munmap
+#endif
+
+namespace sya {
+  namespace {
+    // state shared with the native code, which can't let exceptions unwind through it
+    struct JitContext {
+      bool failed = false; // read by the native code after every call
+      std::optional<ErrorCode> error; // the domain error of the failed call
+      std::exception_ptr exception;   // what it threw otherwise
+    };
+
+    enum JitStatus : int { OK = 0, DIVISION_BY_ZERO = 1, CALL_FAILED = 2 };
+
+    // signature of the native code: slot values, evaluation stack, context and temporaries
+    template <typename T>
+    using NativeFn = int (*)(double* slots, T* stack, JitContext* ctx, T* temps);
+
+    // every function goes through here, so that an exception becomes a flag the native code checks.
+    // Only failing calls look up the function behind the routine, for the error code the interpreter returns
+    template <typename T>
+    T jit_call(JitContext* ctx, FunctionPtr<T> fn, const T* args) noexcept {
+      try {
+        return fn(args);
+      }
+      catch (...) {
+        for (std::size_t id = 0; id < functions.size() && !ctx->error; id++)
+          if (resolve_function<T>(static_cast<Function>(id)) == fn) ctx->error = domain_error(static_cast<Function>(id), args);
+        if (!ctx->error) ctx->exception = std::current_exception();
+        ctx->failed = true;
+        return T{};
+      }
+    }
+
+    template <typename T>
+    T jit_pow(const T* args) { return std::pow(args[0], args[1]); }
+
+#if defined(SYA_JIT_X86_64)
+    // a minimal x86-64 encoder, for the few instructions the translation needs
+    class Assembler {
+      private:
+      std::vector<std::uint8_t> m_code;
+
+      public:
+      enum Reg : std::uint8_t { RAX = 0, RCX = 1, RDX = 2, RBX = 3, RSI = 6, RDI = 7, R12 = 12, R13 = 13, R14 = 14 };
+
+      void byte(std::uint8_t b) { m_code.push_back(b); }
+      void bytes(std::initializer_list<std::uint8_t> bs) { m_code.insert(m_code.end(), bs); }
+      template <typename V>
+      void value(V v) {
+        std::uint8_t raw[sizeof(V)];
+        std::memcpy(raw, &v, sizeof(V));
+        m_code.insert(m_code.end(), raw, raw + sizeof(V));
+      }
+
+      // [base + disp32] operand with `reg` in the ModRM reg field
+      void memory(std::uint8_t reg, Reg base, std::int32_t disp) {
+        byte(static_cast<std::uint8_t>(0x80 | ((reg & 7) << 3) | (base & 7)));
+        if ((base & 7) == 4) byte(0x24); // rsp and r12 need a SIB byte
+        value(disp);
+      }
+
+      // SSE instruction `prefix 0F op xmm, [base + disp]` (or the reverse for stores)
+      void sse(std::uint8_t prefix, std::uint8_t op, std::uint8_t xmm, Reg base, std::int32_t disp) {
+        if (prefix) byte(prefix); // mandatory prefixes come before REX
+        const std::uint8_t rex = 0x40 | (xmm >= 8 ? 4 : 0) | (base >= 8 ? 1 : 0);
+        if (rex != 0x40) byte(rex);
+        bytes({0x0F, op});
+        memory(xmm, base, disp);
+      }
+
+      std::size_t jump(std::initializer_list<std::uint8_t> opcode) { // emit a rel32 jump, returns where to patch it
+        bytes(opcode);
+        value<std::int32_t>(0);
+        return m_code.size() - 4;
+      }
+      void patch(std::size_t at, std::size_t target) { // make the jump at `at` land on `target`
+        const auto rel = static_cast<std::int32_t>(static_cast<std::ptrdiff_t>(target) - static_cast<std::ptrdiff_t>(at + 4));
+        std::memcpy(m_code.data() + at, &rel, sizeof(rel));
+      }
+
+      [[nodiscard]] std::size_t size() const noexcept { return m_code.size(); }
+      [[nodiscard]] const std::vector<std::uint8_t>& code() const noexcept { return m_code; }
+    };
+
+    // translate a program to native code, the stack depth at every instruction is known from compile()
+    template <typename T>
+    std::vector<std::uint8_t> translate(const BasicProgram<T>& program) {
+      using A = Assembler;
+      constexpr bool is_double = std::is_same_v<T, double>;
+      constexpr std::uint8_t scalar = is_double ? 0xF2 : 0xF3; // movsd/addsd... or movss/addss...
+      constexpr auto size = static_cast<std::int32_t>(sizeof(T));
+
+      A a;
+      std::vector<std::size_t> division_exits, call_exits;
+
+      // prologue: keep the arguments in callee-saved registers, so that calls don't clobber them
+      a.bytes({0x53, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56}); // push rbx, r12, r13, r14
+      a.bytes({0x48, 0x83, 0xEC, 0x08});                   // sub rsp, 8 (16-byte alignment at calls)
+      a.bytes({0x48, 0x89, 0xFB});                         // mov rbx, rdi (slots)
+      a.bytes({0x49, 0x89, 0xF4});                         // mov r12, rsi (stack)
+      a.bytes({0x49, 0x89, 0xD5});                         // mov r13, rdx (context)
+      a.bytes({0x49, 0x89, 0xCE});                         // mov r14, rcx (temporaries)
+
+      auto at = [&](std::size_t index) { return static_cast<std::int32_t>(index) * size; }; // stack entry offset
+      auto call = [&](FunctionPtr<T> fn, std::size_t first) { // result = fn(&stack[first]), into stack[first]
+        a.bytes({0x4C, 0x89, 0xEF});                            // mov rdi, r13
+        a.bytes({0x48, 0xBE}); a.value(reinterpret_cast<std::uint64_t>(fn)); // mov rsi, fn
+        a.byte(0x49); a.byte(0x8D); a.memory(A::RDX, A::R12, at(first)); // lea rdx, [r12 + first]
+        a.bytes({0x48, 0xB8}); a.value(reinterpret_cast<std::uint64_t>(&jit_call<T>)); // mov rax, jit_call
+        a.bytes({0xFF, 0xD0});                                  // call rax
+        a.sse(scalar, 0x11, 0, A::R12, at(first));              // mov [r12 + first], xmm0
+        a.bytes({0x41, 0x80, 0xBD}); a.value<std::int32_t>(0); a.byte(0x00); // cmp byte [r13 + failed], 0
+        call_exits.push_back(a.jump({0x0F, 0x85}));             // jne call_failed
+      };
+
+      std::size_t top = 0; // stack depth before each instruction, known at translation time
+      for (const Instruction& in : program.code) {
+        switch (in.op) {
+          case OpCode::PUSH: {
+            const T literal = program.literals[in.arg];
+            if constexpr (is_double) {
+              a.bytes({0x48, 0xB8}); a.value(literal);           // mov rax, literal bits
+              a.byte(0x49); a.byte(0x89); a.memory(A::RAX, A::R12, at(top)); // mov [r12 + top], rax
+            } else {
+              a.byte(0xB8); a.value(literal);                    // mov eax, literal bits
+              a.byte(0x41); a.byte(0x89); a.memory(A::RAX, A::R12, at(top)); // mov [r12 + top], eax
+            }
+            top++;
+            break;
+          }
+          case OpCode::LOAD: {
+            const auto slot = static_cast<std::int32_t>(in.arg * sizeof(double));
+            if constexpr (is_double) a.sse(0xF2, 0x10, 0, A::RBX, slot); // movsd xmm0, [rbx + slot]
+            else a.sse(0xF2, 0x5A, 0, A::RBX, slot);                     // cvtsd2ss xmm0, [rbx + slot]
+            a.sse(scalar, 0x11, 0, A::R12, at(top));
+            top++;
+            break;
+          }
+          case OpCode::STORE: {
+            const auto slot = static_cast<std::int32_t>(in.arg * sizeof(double));
+            if constexpr (is_double) a.sse(0xF2, 0x10, 0, A::R12, at(top - 1));
+            else a.sse(0xF3, 0x5A, 0, A::R12, at(top - 1)); // cvtss2sd xmm0, [r12 + top - 1]
+            a.sse(0xF2, 0x11, 0, A::RBX, slot);             // movsd [rbx + slot], xmm0
+            break;
+          }
+          case OpCode::ADD: case OpCode::SUB: case OpCode::MUL: case OpCode::DIV: {
+            if (in.op == OpCode::DIV) { // the interpreter throws on a zero divisor, NaN is not zero
+              a.bytes(is_double ? std::initializer_list<std::uint8_t>{0x66, 0x0F, 0x57, 0xC9}
+                                : std::initializer_list<std::uint8_t>{0x0F, 0x57, 0xC9}); // xorpd/xorps xmm1, xmm1
+              a.sse(is_double ? 0x66 : 0, 0x2E, 1, A::R12, at(top - 1)); // ucomisd/ucomiss xmm1, [r12 + top - 1]
+              a.bytes({0x7A, 0x06});                                     // jp +6 (unordered)
+              division_exits.push_back(a.jump({0x0F, 0x84}));            // je division_by_zero
+            }
+
+            const std::uint8_t op = in.op == OpCode::ADD ? 0x58 : in.op == OpCode::SUB ? 0x5C : in.op == OpCode::MUL ? 0x59 : 0x5E;
+            a.sse(scalar, 0x10, 0, A::R12, at(top - 2)); // mov xmm0, left
+            a.sse(scalar, op, 0, A::R12, at(top - 1));   // op xmm0, right
+            a.sse(scalar, 0x11, 0, A::R12, at(top - 2)); // mov left, xmm0
+            top--;
+            break;
+          }
+          case OpCode::POW: call(&jit_pow<T>, top - 2); top--; break;
+          case OpCode::CALL: call(program.functions[in.arg], top - in.arity); top = top - in.arity + 1; break;
+          case OpCode::SAVE: {
+            a.sse(scalar, 0x10, 0, A::R12, at(top - 1));
+            a.sse(scalar, 0x11, 0, A::R14, at(in.arg));
+            break;
+          }
+          case OpCode::RECALL: {
+            a.sse(scalar, 0x10, 0, A::R14, at(in.arg));
+            a.sse(scalar, 0x11, 0, A::R12, at(top));
+            top++;
+            break;
+          }
+        }
+      }
+
+      a.bytes({0x31, 0xC0}); // xor eax, eax (OK)
+      const std::size_t exit = a.size();
+      a.bytes({0x48, 0x83, 0xC4, 0x08});                   // add rsp, 8
+      a.bytes({0x41, 0x5E, 0x41, 0x5D, 0x41, 0x5C, 0x5B}); // pop r14, r13, r12, rbx
+      a.byte(0xC3);                                        // ret
+
+      const std::size_t division = a.size();
+      a.byte(0xB8); a.value<std::int32_t>(DIVISION_BY_ZERO); // mov eax, DIVISION_BY_ZERO
+      a.patch(a.jump({0xE9}), exit);
+      const std::size_t failed = a.size();
+      a.byte(0xB8); a.value<std::int32_t>(CALL_FAILED);      // mov eax, CALL_FAILED
+      a.patch(a.jump({0xE9}), exit);
+
+      for (std::size_t at : division_exits) a.patch(at, division);
+      for (std::size_t at : call_exits) a.patch(at, failed);
+      return a.code();
+    }
+#endif
+  }
+
+  template <typename T>
+  BasicJitProgram<T>::BasicJitProgram(BasicProgram<T> program) : m_program(std::move(program)) {
+#if defined(SYA_JIT_X86_64)
+    if constexpr (std::is_same_v<T, float> || std::is_same_v<T, double>) { // long double needs x87, it's interpreted
+      static_assert(offsetof(JitContext, failed) == 0, "the native code checks the flag at offset 0");
+
+      const auto code = translate(m_program);
+      void* buffer = ::mmap(nullptr, code.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (buffer == MAP_FAILED) return; // interpreted
+
+      std::memcpy(buffer, code.data(), code.size());
+      if (::mprotect(buffer, code.size(), PROT_READ | PROT_EXEC) != 0) { // never writable and executable at once
+        ::munmap(buffer, code.size());
+        return;
+      }
+      m_code = buffer;
+      m_size = code.size();
+    }
+#endif
+  }
+
+  template <typename T>
+  BasicJitProgram<T>::BasicJitProgram(BasicJitProgram&& other) noexcept
+    : m_program(std::move(other.m_program)), m_code(std::exchange(other.m_code, nullptr)), m_size(std::exchange(other.m_size, 0)) {}
+
+  template <typename T>
+  BasicJitProgram<T>& BasicJitProgram<T>::operator=(BasicJitProgram&& other) noexcept {
+    if (this != &other) {
+      release();
+      m_program = std::move(other.m_program);
+      m_code = std::exchange(other.m_code, nullptr);
+      m_size = std::exchange(other.m_size, 0);
+    }
+    return *this;
+  }
+
+  template <typename T>
+  void BasicJitProgram<T>::release() noexcept {
+#if defined(SYA_JIT_X86_64)
+    if (m_code) ::munmap(m_code, m_size);
+#endif
+    m_code = nullptr;
+    m_size = 0;
+  }
+
+  template <typename T>
+  [[nodiscard]] Result<std::optional<T>> BasicJitProgram<T>::try_evaluate(std::span<double> slots) const {
+    if (!m_code) return sya::try_evaluate(m_program, slots);
+    SYA_STATS_TIME(EVALUATE);
+
+    std::array<T, 64> buffer; // same stack and temporaries layout as the interpreter
+    std::vector<T> heap;
+    T* stack = buffer.data();
+    if (m_program.depth > buffer.size()) {
+      heap.resize(m_program.depth);
+      stack = heap.data();
+    }
+
+    std::array<T, 16> temp_buffer;
+    std::vector<T> temp_heap;
+    T* temps = temp_buffer.data();
+    if (m_program.temps > temp_buffer.size()) {
+      temp_heap.resize(m_program.temps);
+      temps = temp_heap.data();
+    }
+
+    JitContext ctx;
+    switch (reinterpret_cast<NativeFn<T>>(m_code)(slots.data(), stack, &ctx, temps)) {
+      case DIVISION_BY_ZERO: return std::unexpected(Error{ErrorCode::DIVISION_BY_ZERO});
+      case CALL_FAILED: {
+        if (ctx.error) return std::unexpected(Error{*ctx.error});
+        std::rethrow_exception(ctx.exception); // not an invalid expression
+      }
+      default: break;
+    }
+
+    if (m_program.assigns || m_program.code.empty()) return std::optional<T>();
+    return stack[0];
+  }
+
+  template <typename T>
+  [[nodiscard]] std::optional<T> BasicJitProgram<T>::evaluate(std::span<double> slots) const {
+    auto result = try_evaluate(slots);
+    if (!result) raise(result.error());
+    return *result;
+  }
+
+  template <typename T>
+  [[nodiscard]] BasicJitProgram<T> jit_compile(const Expression& rpn_expr) {
+    return BasicJitProgram<T>(compile<T>(rpn_expr));
+  }
+
+  template <typename T>
+  [[nodiscard]] Result<std::optional<T>> try_evaluate(const BasicJitProgram<T>& jit, SymbolTable& table) {
+    return evaluate_bound(jit.program(), table, [&](std::span<double> slots) { return jit.try_evaluate(slots); });
+  }
+
+  template <typename T>
+  [[nodiscard]] std::optional<T> evaluate(const BasicJitProgram<T>& jit, SymbolTable& table) {
+    auto result = try_evaluate(jit, table);
+    if (!result) raise(result.error());
+    return *result;
+  }
+
+  template class BasicJitProgram<float>;
+  template class BasicJitProgram<double>;
+  template class BasicJitProgram<long double>;
+
+  template BasicJitProgram<float> jit_compile<float>(const Expression&);
+  template BasicJitProgram<double> jit_compile<double>(const Expression&);
+  template BasicJitProgram<long double> jit_compile<long double>(const Expression&);
+
+  template Result<std::optional<float>> try_evaluate<float>(const BasicJitProgram<float>&, SymbolTable&);
+  template Result<std::optional<double>> try_evaluate<double>(const BasicJitProgram<double>&, SymbolTable&);
+  template Result<std::optional<long double>> try_evaluate<long double>(const BasicJitProgram<long double>&, SymbolTable&);
+
+  template std::optional<float> evaluate<float>(const BasicJitProgram<float>&, SymbolTable&);
+  template std::optional<double> evaluate<double>(const BasicJitProgram<double>&, SymbolTable&);
+  template std::optional<long double> evaluate<long double>(const BasicJitProgram<long double>&, SymbolTable&);
+}
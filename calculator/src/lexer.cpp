@@ -0,0 +1,172 @@
+#include "lexer.hpp"
+#include "operator.hpp"
+#include "utils.hpp"
+#include "variable.hpp"
+
+namespace sya {
+  Lexer::Lexer(std::string_view src) noexcept : m_src(src) {
+    if (m_src.empty()) fail(ErrorCode::EMPTY_EXPRESSION, 0); // handle empty expression case
+  }
+
+  void Lexer::fail(ErrorCode code, std::size_t pos, std::string_view text) noexcept {
+    m_error = Error{code, static_cast<uint32_t>(pos), text};
+    m_done = true;
+    m_head = m_tail = 0; // lexemes of the failing character are dropped
+  }
+
+  void Lexer::push(std::string_view text, TokenType type) noexcept {
+    // implicit lexemes view static literals, not the source
+    const bool in_source = !m_src.empty() && text.data() >= m_src.data() && text.data() < m_src.data() + m_src.size();
+    const auto position = in_source ? static_cast<uint32_t>(text.data() - m_src.data() + 1) : uint32_t{0};
+    m_queue[m_tail++] = {text, type, position};
+    m_last = {text, type, position};
+    m_count++;
+  }
+
+  void Lexer::push_token() {
+    using namespace utils;
+    using tt = TokenType;
+
+    if (m_ct.empty()) return; // nothing to push
+
+    if (is_number(m_ct)) push(m_ct, tt::NUMBER); // if it's a number, push as number token
+    else if (is_function(m_ct)) push(m_ct, tt::FUNCTION); // if it's a function, push as function token
+    else if (validate_variable_name(m_ct)) push(m_ct, tt::VARIABLE); // if it's a valid variable name, push as variable token
+    else if (m_ct.size() == 1 && is_operator(m_ct.front())) push(m_ct, tt::OPERATOR); // if it's a single char operator, push as operator token
+    else push(m_ct, tt::UNKNOWN); // otherwise, push as unknown token
+
+    m_ct = {}; // clear the current token after pushing
+  }
+
+  std::optional<Lexeme> Lexer::next() {
+    while (m_head == m_tail) { // scan until at least one lexeme is ready
+      if (m_done) return std::nullopt;
+      m_head = m_tail = 0;
+      step();
+    }
+    return m_queue[m_head++];
+  }
+
+  void Lexer::step() {
+    using namespace utils;
+    using tt = TokenType;
+    using uc = unsigned char;
+
+    auto numlike  = [](uc c) -> bool { return is_digit(c) || c == '.'; }; // for handling numbers/decimals
+    auto push_op  = [&](std::string_view op) { push(op, tt::OPERATOR); }; // for pushing operators
+    auto extend   = [&](std::size_t i) { // grow the current token by the source character at i
+      m_ct = m_ct.empty() ? m_src.substr(i, 1) : std::string_view(m_ct.data(), m_ct.size() + 1);
+    };
+
+    if (m_pos == m_src.size()) { // end of the expression
+      push_token();
+      m_done = true;
+
+      if (m_pb != 0) { // check for mismatched parentheses after processing the entire expression, only closing ones can be missing
+        fail(ErrorCode::MISSING_CLOSING_PARENT, 0);
+        m_error->got = static_cast<uint16_t>(m_pb);
+      }
+      return;
+    }
+
+    const size_t i = m_pos++;
+    const uc c = m_src[i]; const uc n = (i + 1 < m_src.size()) ? m_src[i + 1] : '\0'; // current and next character (if any)
+    size_t pos = i+1; // for error messages (1-based index)
+
+    if (is_space(c)) { // skip whitespace, but check for invalid whitespace in numbers like "1 2" or "1. 2"
+      if (!m_ct.empty() && (numlike(n) || is_letter(n)))
+        fail(ErrorCode::WHITESPACE_IN_NUMBER, pos);
+
+      return;
+    }
+    if (numlike(c)) {
+      if (c == '.') { // handle decimal point, numbers like ".5" or "-.5" are kept as written
+        if (m_ct.find('.') != std::string_view::npos || !is_digit(n)) // multiple decimal points or decimal point not followed by digit
+          return fail(ErrorCode::MULTIPLE_DECIMAL_POINTS, pos);
+      }
+
+      extend(i);
+      if (is_letter(n)) { // handle cases like "1x" by treating them as "1*x"
+        push_token(); // push the current number token before handling the implicit multiplication
+        push_op("*"); // push the implicit multiplication operator
+      }
+      return;
+    }
+    if (c == '(') {
+      if (n == ')') // handle empty parentheses "()"
+        return fail(ErrorCode::EMPTY_PARENTHESES, pos);
+
+      push_token(); // push any current token before handling the parenthesis
+
+      if (is_number(m_last.text) || m_last.type == tt::VARIABLE ||
+          m_last.type == tt::CLOSE_PARENT) push_op("*"); // handle implicit multiplication like "2(3+4)" or "(1+2)(3+4)"
+
+      push(m_src.substr(i, 1), tt::OPEN_PARENT); // push the open parenthesis token
+      m_pb++; // increment parenthesis balance counter
+
+      return;
+    }
+    if (c == ')') {
+      push_token(); // push any current token before handling the parenthesis
+      push(m_src.substr(i, 1), tt::CLOSE_PARENT); // push the close parenthesis token
+
+      if (is_digit(n) || is_letter(n)) push_op("*"); // handle implicit multiplication like "(1+2)3"
+
+      m_pb--; // decrement parenthesis balance counter
+      if (m_pb < 0)
+        fail(ErrorCode::UNEXPECTED_CLOSING_PARENT, pos);
+
+      return;
+    }
+    if (is_operator(c)) {
+      push_token(); // push any current token before handling the operator
+
+      if (is_unary(c) && m_ct.empty() &&
+      (m_count == 0 || m_last.type == tt::OPERATOR    ||
+                       m_last.type == tt::OPEN_PARENT ||
+                       m_last.type == tt::SEPARATOR)) { // handle unary operators at the start of the expression or after an operator/open parenthesis/separator
+        if (n == ')' || n == ',' || is_space(n))
+          return fail(ErrorCode::UNEXPECTED_AFTER_UNARY, pos, m_src.substr(i + 1, 1));
+        if (is_unary(n) && (n == c || n == '-' || n == '+')) // handle unary operator duplication
+          return fail(ErrorCode::DOUBLE_UNARY, pos, m_src.substr(i + 1, 1));
+
+        // start building the unary operator as part of the number token (e.g. "-5" or "+3.14"),
+        // cases like "-(3+4)" are treated as "-1*(3+4)"
+        if (n == '(') m_ct = (c == '-') ? "-1" : "+1";
+        else extend(i);
+
+        return;
+      } else if (c == '=') {
+        if (is_number(m_last.text) || m_last.type == tt::CLOSE_PARENT) // handle cases like "x=5" or "(1+2)=3" by treating them as "x=5" or "(1+2)=3"
+          return fail(ErrorCode::ASSIGNMENT_TO_VALUE, pos);
+        else if (is_function(m_last.text)) // handle cases like "sin=5" by treating them as "sin=5"
+          return fail(ErrorCode::ASSIGNMENT_TO_FUNCTION, pos);
+        else if (is_constant(m_last.text)) // handle cases like "pi=3.14" by treating them as "pi=3.14"
+          return fail(ErrorCode::ASSIGNMENT_TO_CONSTANT, pos);
+      }
+
+      if (is_operator(n) && !is_unary(n)) // handle operator duplication
+        return fail(ErrorCode::DOUBLE_OPERATOR, pos, m_src.substr(i + 1, 1));
+
+      push_op(m_src.substr(i, 1)); // push the operator token
+
+      return;
+    }
+    if (is_letter(c)) {
+      extend(i);
+
+      return;
+    }
+    if (c == ',') {
+      push_token(); // push any current token before handling the separator
+
+      if (m_last.type == tt::OPEN_PARENT || n == ')' || m_pb == 0) // handle cases like "f(,)" or "f(x,)" where the separator is misplaced
+        return fail(ErrorCode::MISPLACED_SEPARATOR, pos);
+
+      push(m_src.substr(i, 1), tt::SEPARATOR); // push the separator token
+      return;
+    }
+
+    fail(ErrorCode::INVALID_CHARACTER, pos, m_src.substr(i, 1));
+  }
+}
@@ -1,213 +1,164 @@
 #include "logic.hpp"
 #include "operator.hpp"
+#include "stats.hpp"
 
 #include <fmt/core.h>
 #include <vector>
+#include <cmath>     // for std::pow
+#include <algorithm> // for std::fill_n, std::copy_n, std::find_if
 
 namespace sya {
-  [[nodiscard]] Expression to_rpn(const Expression& expr) { // convert expression to RPN using the shunting yard algorithm
-      using tt = TokenType;
-
-      Expression output; // the output expression in RPN form
-      Token token;
-      std::vector<Token> op_stack; // the operator stack which stores operators and functions during the conversion process
-      std::vector<FunctionInfo> fs; // the function stack which stores function information (name and argument count) during the conversion process
-      std::vector<std::string> stored_variable; // to store variable tokens to push them later in end of convertion process
-
-      if (expr.empty()) throw std::runtime_error("Empty expression"); // handle empty expression case
-      if ((expr.at(0).type() == tt::OPERATOR && !is_unary(expr.at(0).get()))
-          || (expr.at(expr.size()-1).type() == tt::OPERATOR && !is_unary(expr.at(expr.size()-1).get()))) // handle invalid starting/ending operator case
-        throw std::runtime_error("Invalid expression: unexpected operator at the start/end of the expression");
-
-      op_stack.reserve(expr.size()); // reserve space for operators to avoid unnecessary reallocations later
-
-      auto pop_operator = [&] { // pop operator from operator stack (op_stack) to output (rpn expression)
-        output.push(op_stack.back());
-        op_stack.pop_back();
-      };
-
-      // pop operators from operator stack to output until an open parenthesis
-      // is encountered (used for handling parentheses and function argument separators)
-      auto pop_until_open_parent = [&] {
-        while (!op_stack.empty() && op_stack.back().type() != tt::OPEN_PARENT) pop_operator();
-      };
-
-      for (size_t i = 0; i < expr.size(); i++) { // iterate over tokens in the input expression
-        token = expr[i]; // get the current token
-        switch (token.type()) { // handle token based on its type
-          case tt::NUMBER: { // if it's a number, push it directly to the output
-            output.push(token);
-            break;
-          }
-          case tt::OPERATOR: { // if it's an operator
-            // pop operators from the operator stack to the output while the operator at the top
-            // of the stack has greater precedence, or equal precedence and is left associative (for non-unary operators)
-            if (token.get() == "=") {
-              // all output tokens so far must be VARIABLE only
-              for (const auto& t : output) {
-                if (t.type() != tt::VARIABLE) {
-                  throw std::runtime_error("Invalid assignment: cannot assign to an expression, only to variables");
-                }
-              }
-              continue;
+  namespace {
+    // the column bound to a variable of a batch, null if it has none
+    template <typename T>
+    const T* find_column(std::string_view name, std::span<const BasicColumn<T>> columns, std::size_t rows) {
+      auto col = std::find_if(columns.begin(), columns.end(), [&](const BasicColumn<T>& c) { return c.name == name; });
+      if (col == columns.end()) return nullptr;
+      if (col->values.size() < rows)
+        throw std::logic_error(fmt::format("Invalid batch: column '{}' is shorter than the output", name));
+      return col->values.data();
+    }
+
+    // evaluate the rows of a batch, the column or broadcast value of a variable is found at the operand of its LOAD
+    template <typename T>
+    void run_batch(const BasicProgram<T>& program, const std::vector<const T*>& column_of,
+                   const std::vector<T>& scalar_of, std::span<T> results) {
+      // every step runs over a whole block of rows, so that the arithmetic loops below are plain
+      // element-wise loops over contiguous arrays which the compiler can auto-vectorize
+      constexpr std::size_t block = 256;
+
+      std::vector<T> stack(std::max<std::size_t>(program.depth, 1) * block); // one row of `block` values per stack entry
+      std::vector<T> temps(program.temps * block); // one row per temporary
+
+      for (std::size_t base = 0; base < results.size(); base += block) {
+        const std::size_t n = std::min(block, results.size() - base);
+        T* top = stack.data(); // start of the row past the top of the stack
+
+        // apply an element-wise binary operation to the two top rows, leaving the result in place of the left one
+        auto binary = [&](auto op) {
+          T* a = top - 2 * block;
+          const T* b = top - block;
+          for (std::size_t i = 0; i < n; i++) a[i] = op(a[i], b[i]);
+          top -= block;
+        };
+
+        for (const Instruction& in : program.code) {
+          switch (in.op) {
+            case OpCode::PUSH: std::fill_n(top, n, program.literals[in.arg]); top += block; break;
+            case OpCode::LOAD: {
+              if (column_of[in.arg]) std::copy_n(column_of[in.arg] + base, n, top);
+              else std::fill_n(top, n, scalar_of[in.arg]);
+              top += block;
+              break;
             }
-            while (!op_stack.empty()
-              && is_operator(op_stack.back().get())
-              && (opprec(op_stack.back().get()) > opprec(token.get())
-              || (opprec(op_stack.back().get()) == opprec(token.get()) && !is_right_associative(token.get())))) pop_operator();
-             op_stack.push_back(token); // push the current operator to the operator stack
-            break;
-          }
-          case tt::FUNCTION: { // if it's a function
-            fs.push_back({token.get(), 0}); // push function info (name and initial argument count) to the function stack
-            op_stack.push_back(token); // push the function token to the operator stack (functions are treated as operators during the conversion process)
-            break;
-          }
-          case tt::VARIABLE : {
-            if ((i + 1) < expr.size() && expr[i + 1].type() == tt::OPERATOR && expr[i + 1].get() == "=")
-              stored_variable.push_back(token.get()); // store variable token
-            else
-              output.push(token); // push variable token directly to output for use in evaluation              
-            break;
-          }
-          case tt::OPEN_PARENT: { // if it's an open parenthesiss
-            op_stack.push_back(token); // push it to the operator stack
-            break;
-          }
-          case tt::SEPARATOR: { // if it's a function argument separator (comma) like in "max(1, 2)"
-            pop_until_open_parent();
-            if (fs.empty()) // if there's no function in the function stack, it means the separator is outside of a function, which is invalid
-              throw std::logic_error("Invalid function: separator outside function");
-            fs.back().arg_count++; // increment the argument count for the current function being processed
-            break;
-          }
-          case tt::CLOSE_PARENT: { // if it's a close parenthesis
-            pop_until_open_parent();
-            // if the operator stack is empty after popping until an open parenthesis,
-            // it means there's a mismatched closing parenthesis
-            if (op_stack.empty())
-              throw std::logic_error("Invalid expression: mismatched parentheses");
-            op_stack.pop_back(); // pop the open parenthesis from the operator stack
-            
-            if (!op_stack.empty() && op_stack.back().type() == tt::FUNCTION) { // in case of a function call
-              // increment the argument count for current function as the last argument would be before this closing parenthesis
-              fs.back().arg_count++;
-
-              if (!op_stack.empty() && op_stack.back().type() == tt::FUNCTION) { // if we are at the function name
-                auto fn = op_stack.back().get(); // get it's name
-                auto ac = fs.back().arg_count; // and the argument count too
-
-                // if the argument count doesn't match the expected count for this function,
-                // it's an argument count mismatch error
-                if (functions.at(fn) != ac)
-                  throw std::logic_error(fmt::format(
-                        "Invalid function: argument count mismatch for {}(). Expected {}, got {}",
-                        fn, functions.at(fn), ac));
-                
-                pop_operator(); // pop the function token from the operator stack to the output
-                fs.pop_back(); // pop the function info from the function stack as well since we're done processing this function
+            case OpCode::STORE: break; // rejected above
+            case OpCode::ADD: binary([](T l, T r) { return l + r; }); break;
+            case OpCode::SUB: binary([](T l, T r) { return l - r; }); break;
+            case OpCode::MUL: binary([](T l, T r) { return l * r; }); break;
+            case OpCode::DIV: {
+              const T* b = top - block;
+              bool zero = false;
+              for (std::size_t i = 0; i < n; i++) zero |= (b[i] == 0);
+              if (zero) raise({ErrorCode::DIVISION_BY_ZERO});
+              binary([](T l, T r) { return l / r; });
+              break;
+            }
+            case OpCode::POW: binary([](T l, T r) { return std::pow(l, r); }); break;
+            case OpCode::CALL: {
+              T* first = top - in.arity * block; // row of the first argument, receives the result
+              T args[8]; // no function takes more arguments
+              for (std::size_t i = 0; i < n; i++) {
+                for (std::size_t k = 0; k < in.arity; k++) args[k] = first[k * block + i];
+                first[i] = program.functions[in.arg](args);
               }
+              top = first + block;
+              break;
             }
-            break;
-          }
-          default: throw std::logic_error("Invalid token: unsupported token type"); // handle unsupported tokens
-        }
-      }
-
-      // if there are still functions in the function stack after processing all tokens,
-      // it means there's a mismatched opening parenthesis for a function call
-      if (!fs.empty())
-        throw std::logic_error("Invalid expression: mismatched parentheses");
-
-      while (!op_stack.empty()) pop_operator(); // pop any remaining operators from the operator stack to the output
-      
-      if (!stored_variable.empty()) {
-        bool has_assignment = false;
-        for (const Token& t : expr) {
-          if (t.type() == tt::OPERATOR && t.get() == "=") {
-            has_assignment = true;
-            break;
+            case OpCode::SAVE: std::copy_n(top - block, n, temps.data() + in.arg * block); break;
+            case OpCode::RECALL: std::copy_n(temps.data() + in.arg * block, n, top); top += block; break;
           }
         }
 
-        if (has_assignment) {
-          // Emit assignments in reverse order so right-most assignment happens first.
-          for (auto it = stored_variable.rbegin(); it != stored_variable.rend(); ++it) {
-            output.push({*it, tt::VARIABLE});
-            output.push({"=", tt::OPERATOR});
-          }
-        } else {
-          for (const auto& var : stored_variable)
-            output.push({var, tt::VARIABLE});
-        }
+        std::copy_n(stack.data(), n, results.data() + base);
       }
+    }
+  }
 
-      return output; // rpn expression
+  [[nodiscard]] Expression to_rpn(const Expression& expr, std::pmr::memory_resource* resource) {
+    auto rpn = try_to_rpn(expr, resource);
+    if (!rpn) raise(rpn.error());
+    return std::move(*rpn);
   }
 
-  [[nodiscard]] std::optional<float> evaluate_rpn(const Expression& rpn_expr, std::vector<Variable>& variables) {
+  template <typename T>
+  [[nodiscard]] std::optional<T> evaluate_rpn(const Expression& rpn_expr, std::vector<Variable>& variables,
+                                              std::pmr::memory_resource* resource) {
+    SYA_STATS_TIME(EVALUATE);
     using tt = TokenType;
-    Token token;
-    std::vector<float> stack; // evaluation stack for evaluating the RPN expression
+    std::pmr::vector<T> stack(resource); // evaluation stack for evaluating the RPN expression
+    std::pmr::vector<T> args(resource); // arguments of the function being called, reused by every call
     bool is_assignement = false; // flag to indicate if the expression contains an assignment operator
 
     stack.reserve(rpn_expr.size());    
 
     for (size_t i = 0; i < rpn_expr.size(); i++) { // iterate over tokens in the RPN expression
-      token = rpn_expr[i]; // get the current token
+      const Token& token = rpn_expr[i]; // get the current token
       switch (token.type()) { // handle token based on its type
         case tt::NUMBER: { // if it's a number, push its value to the evaluation stack
-          stack.push_back(std::stof(token.get()));
+          T value{};
+          const std::errc parsed = utils::parse_number(token.view(), value);
+          if (parsed == std::errc::result_out_of_range) raise({ErrorCode::NUMBER_OUT_OF_RANGE, 0, token.view()});
+          if (parsed != std::errc()) raise({ErrorCode::INVALID_NUMBER, 0, token.view()});
+          stack.push_back(value);
           break;
         }
         case tt::OPERATOR: { // if it's an operator, pop the required number of operands from the stack and apply the operator
-          auto op = token.get();
+          auto op = token.view();
           if (op == "=") continue;
-          if (stack.size() < 2) throw std::logic_error("Invalid expression: insufficient operands for binary operator");
-          float right = stack.back(); stack.pop_back();
-          float left = stack.back(); stack.pop_back();
+          if (stack.size() < 2) raise({ErrorCode::MISSING_OPERAND});
+          T right = stack.back(); stack.pop_back();
+          T left = stack.back(); stack.pop_back();
           stack.push_back(apply_operator(op, left, right)); // apply the binary operator and push the result back to the stack
           break;
         }
         case tt::FUNCTION: { // if it's a function, pop the required number of arguments from the stack and apply the function
-          auto fn = token.get();
-          auto arg_count = functions.at(fn); // get the expected argument count for this function
-          if (stack.size() < arg_count) throw std::logic_error(fmt::format("Invalid expression: insufficient arguments for function {}()", fn));
+          auto fn = token.view();
+          auto arg_count = function_arity(fn); // get the expected argument count for this function
+          if (stack.size() < arg_count) raise({ErrorCode::MISSING_ARGUMENTS, 0, fn});
           
-          std::vector<float> args(arg_count); // vector to hold function arguments
+          args.resize(arg_count); // to hold function arguments
           for (int i = arg_count - 1; i >= 0; i--) { // pop arguments in reverse order since they were pushed in order during evaluation
             args[i] = stack.back();
             stack.pop_back();
           }
-          stack.push_back(apply_function(fn, args)); // apply the function with the popped arguments and push the result back to the stack
+          stack.push_back(apply_function<T>(fn, args)); // apply the function with the popped arguments and push the result back to the stack
           break;
         }
         case tt::VARIABLE: {
-          auto var_name = token.get();
+          auto var_name = token.view();
 
-          if ((i + 1) < rpn_expr.size() && rpn_expr[i + 1].type() == tt::OPERATOR && rpn_expr[i + 1].get() == "=") {
-            if (stack.empty())
-              throw std::logic_error(fmt::format(
-                "Invalid expression: missing value for variable assignment to '{}'", var_name));
+          if ((i + 1) < rpn_expr.size() && rpn_expr[i + 1].type() == tt::OPERATOR && rpn_expr[i + 1].view() == "=") {
+            if (stack.empty()) raise({ErrorCode::MISSING_ASSIGNED_VALUE, 0, var_name});
             
-            float var_value = stack.back(); stack.pop_back(); // get the value to be assigned to the variable from the top of the stack
+            T var_value = stack.back(); stack.pop_back(); // get the value to be assigned to the variable from the top of the stack
+            SYA_STATS_COUNT(VARIABLE_LOOKUPS);
             auto it = std::find_if(variables.begin(), variables.end(), [&](const Variable& v) { return v.name == var_name; });
             if (it != variables.end())
               it->value = var_value; // if variable already exists, update its value
-            else variables.push_back({var_name, var_value}); // otherwise, create a new variable with this name and value
+            else variables.push_back({std::string(var_name), static_cast<double>(var_value)}); // otherwise, create a new variable with this name and value
             // Push the assigned value back to the stack so chained assignments keep the value available
             stack.push_back(var_value);
             is_assignement = true;
           } else {
+            SYA_STATS_COUNT(VARIABLE_LOOKUPS);
             auto it = std::find_if(variables.begin(), variables.end(), [&](const Variable& v)
               { return v.name == var_name; });
-            if (it == variables.end())
-              throw std::logic_error(fmt::format("Undefined variable: '{}'", var_name)); // if variable is not defined, it's an undefined variable error
+            if (it == variables.end()) raise({ErrorCode::UNDEFINED_VARIABLE, 0, var_name}); // if variable is not defined, it's an undefined variable error
             stack.push_back(it->value); // push the value of the variable to the stack for use in evaluation
           }
           break;
         }
-        default: throw std::logic_error("Invalid token: unsupported token type during evaluation"); // handle unsupported tokens during evaluation
+        default: raise({ErrorCode::INVALID_TOKEN}); // handle unsupported tokens during evaluation
       }
     }
 
@@ -217,8 +168,78 @@ namespace sya {
     if (is_assignement)
       return std::nullopt;
 
-    if (stack.size() > 1) throw std::logic_error("Invalid expression: too many operands left after evaluation"); // after evaluating the entire RPN expression, there should be exactly one value left on the stack, which is the final result
+    if (stack.size() > 1) raise({ErrorCode::TOO_MANY_OPERANDS}); // after evaluating the entire RPN expression, there should be exactly one value left on the stack, which is the final result
     else if (stack.empty()) return std::nullopt; // if the stack is empty, it means there was no result to return (e.g., in case of an expression that only contains variable assignments without a final value), so we return std::nullopt to indicate the absence of a result
     return stack.back(); // return the final result of evaluating the RPN expression
   }
-}
\ No newline at end of file
+
+  template <typename T>
+  void evaluate_batch(const Expression& rpn_expr, std::span<const BasicColumn<T>> columns,
+                      std::span<T> results, const std::vector<Variable>& variables) {
+    evaluate_batch(compile<T>(rpn_expr), columns, results, variables);
+  }
+
+  template <typename T>
+  void evaluate_batch(const BasicProgram<T>& program, std::span<const BasicColumn<T>> columns,
+                      std::span<T> results, const std::vector<Variable>& variables) {
+    if (program.assigns) throw std::logic_error("Invalid batch: assignments are not supported in batch evaluation");
+    if (!program.symbols.empty()) throw std::logic_error("Invalid program: program is bound to a symbol table");
+
+    std::vector<const T*> column_of(program.names.size(), nullptr); // column bound to each slot, if any
+    std::vector<T> scalar_of(program.names.size(), T{}); // broadcast value of slots without a column
+
+    for (size_t s = 0; s < program.names.size(); s++) {
+      const auto& name = program.names[s];
+      if ((column_of[s] = find_column(name, columns, results.size()))) continue;
+
+      auto it = std::find_if(variables.begin(), variables.end(), [&](const Variable& v) { return v.name == name; });
+      if (it == variables.end()) raise({ErrorCode::UNDEFINED_VARIABLE, 0, name});
+      scalar_of[s] = static_cast<T>(it->value);
+    }
+    run_batch(program, column_of, scalar_of, results);
+  }
+
+  template <typename T>
+  void evaluate_batch(const BasicProgram<T>& program, std::span<const BasicColumn<T>> columns,
+                      std::span<T> results, const SymbolTable& table) {
+    if (program.assigns) throw std::logic_error("Invalid batch: assignments are not supported in batch evaluation");
+    if (program.symbols.size() != program.names.size()) throw std::logic_error("Invalid program: program is not bound to a symbol table");
+
+    std::vector<const T*> column_of(table.size(), nullptr); // by table slot, the operands of a bound program
+    std::vector<T> scalar_of(table.size(), T{});
+
+    for (size_t s = 0; s < program.names.size(); s++) {
+      const auto slot = program.symbols[s];
+      if ((column_of[slot] = find_column(program.names[s], columns, results.size()))) continue;
+
+      if (!table.defined(slot)) raise({ErrorCode::UNDEFINED_VARIABLE, program.positions[s], program.names[s]});
+      scalar_of[slot] = static_cast<T>(table.value(slot));
+    }
+    run_batch(program, column_of, scalar_of, results);
+  }
+
+  template std::optional<float> evaluate_rpn<float>(const Expression&, std::vector<Variable>&, std::pmr::memory_resource*);
+  template std::optional<double> evaluate_rpn<double>(const Expression&, std::vector<Variable>&, std::pmr::memory_resource*);
+  template std::optional<long double> evaluate_rpn<long double>(const Expression&, std::vector<Variable>&, std::pmr::memory_resource*);
+
+  template void evaluate_batch<float>(const Expression&, std::span<const BasicColumn<float>>,
+                                      std::span<float>, const std::vector<Variable>&);
+  template void evaluate_batch<double>(const Expression&, std::span<const BasicColumn<double>>,
+                                       std::span<double>, const std::vector<Variable>&);
+  template void evaluate_batch<long double>(const Expression&, std::span<const BasicColumn<long double>>,
+                                            std::span<long double>, const std::vector<Variable>&);
+
+  template void evaluate_batch<float>(const BasicProgram<float>&, std::span<const BasicColumn<float>>,
+                                      std::span<float>, const std::vector<Variable>&);
+  template void evaluate_batch<double>(const BasicProgram<double>&, std::span<const BasicColumn<double>>,
+                                       std::span<double>, const std::vector<Variable>&);
+  template void evaluate_batch<long double>(const BasicProgram<long double>&, std::span<const BasicColumn<long double>>,
+                                            std::span<long double>, const std::vector<Variable>&);
+
+  template void evaluate_batch<float>(const BasicProgram<float>&, std::span<const BasicColumn<float>>,
+                                      std::span<float>, const SymbolTable&);
+  template void evaluate_batch<double>(const BasicProgram<double>&, std::span<const BasicColumn<double>>,
+                                       std::span<double>, const SymbolTable&);
+  template void evaluate_batch<long double>(const BasicProgram<long double>&, std::span<const BasicColumn<long double>>,
+                                            std::span<long double>, const SymbolTable&);
+}
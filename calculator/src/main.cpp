@@ -1,8 +1,78 @@
 #include "ui.hpp"
+#include "batch.hpp"
 #include "operator.hpp"
+#include "snapshot.hpp"
 
-int main() {
-  console::Interface ui(sya::functions);
+#include <charconv>    // for std::from_chars
+#include <string_view>
+#include <fmt/core.h>
+
+namespace {
+  void print_usage() {
+    fmt::print(stderr,
+      "Usage: calculator [--batch [file]] [--on-error skip|emit|abort] [--jobs N] [--session file | --no-session]\n"
+      "  --batch [file]   evaluate one expression per line of file (or stdin when omitted or '-')\n"
+      "  --on-error       what to do with a line that fails: skip it, emit an error line (default) or abort\n"
+      "  --jobs N         evaluate batch lines on N threads, 0 for one per hardware thread (default 1)\n"
+      "  --session file   session loaded at startup and written by :save (default $CALCULATOR_SESSION or ~/.calculator_session)\n"
+      "  --no-session     start with an empty session\n");
+  }
+}
+
+int main(int argc, char** argv) {
+  bool batch = false;
+  std::string path = "-";
+  console::ErrorPolicy policy = console::ErrorPolicy::EMIT;
+  std::size_t jobs = 1;
+  std::string session = console::default_session_path();
+
+  for (int i = 1; i < argc; i++) {
+    std::string_view arg = argv[i];
+
+    if (arg == "--batch") {
+      batch = true;
+      if (i + 1 < argc && argv[i + 1][0] != '-') path = argv[++i];
+      else if (i + 1 < argc && std::string_view(argv[i + 1]) == "-") i++;
+    }
+    else if (arg == "--on-error" && i + 1 < argc) {
+      std::string_view value = argv[++i];
+      if (value == "skip") policy = console::ErrorPolicy::SKIP;
+      else if (value == "emit") policy = console::ErrorPolicy::EMIT;
+      else if (value == "abort") policy = console::ErrorPolicy::ABORT;
+      else {
+        print_usage();
+        return 2;
+      }
+    }
+    else if (arg == "--jobs" && i + 1 < argc) {
+      std::string_view value = argv[++i];
+      auto [end, error] = std::from_chars(value.data(), value.data() + value.size(), jobs);
+      if (error != std::errc() || end != value.data() + value.size()) {
+        print_usage();
+        return 2;
+      }
+    }
+    else if (arg == "--session" && i + 1 < argc) session = argv[++i];
+    else if (arg == "--no-session") session.clear();
+    else {
+      print_usage();
+      return 2;
+    }
+  }
+
+  if (batch) {
+    try {
+      console::BatchRunner runner(policy, jobs);
+      auto summary = path == "-" ? runner.run_stream(stdin) : runner.run_file(path);
+      return summary.aborted ? 1 : 0;
+    }
+    catch (const std::exception& e) {
+      fmt::print(stderr, "Error: {}\n", e.what());
+      return 1;
+    }
+  }
+
+  console::Interface ui(sya::Engine::shared(), session);
   ui.run();
 
   return 0;
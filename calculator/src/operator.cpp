@@ -1,98 +1,166 @@
 #include "operator.hpp"
+#include "stats.hpp"
 
-#include <math.h>
-#include <fmt/core.h>
+#include <cmath>
+#include <utility> // for std::index_sequence
 
 namespace sya {
-  std::unordered_map<std::string, OperatorPrec> operators = {
-    {"+", OperatorPrec::ADD_SUB},
-    {"-", OperatorPrec::ADD_SUB},
-    {"*", OperatorPrec::MUL_DIV},
-    {"/", OperatorPrec::MUL_DIV},
-    {"^", OperatorPrec::POW},
-    {"=", OperatorPrec::ASSIGNEMENT},
-  };
-
-  std::unordered_map<std::string, std::size_t> functions = {
-    {"sqrt",  1},
-    {"pow",   2},
-    {"cos",   1},
-    {"sin",   1},
-    {"max",   2},
-    {"min",   2},
-    {"abs",   1},
-    {"exp",   1},
-    {"log",   1},
-    {"ln",    1},
-    {"floor", 1},
-    {"ceil",  1},
-    {"round", 1},
-    {"sign",  1},
-    {"hypot", 2},
-    {"atan2", 2},
-    {"sinh",  1},
-    {"cosh",  1},
-    {"tanh",  1},
-    {"asinh", 1},
-    {"acosh", 1},
-    {"atanh", 1}
-  };
-
-  bool is_function(const std::string& token) noexcept {
-    return functions.find(token) != functions.end();
+  [[nodiscard]] std::size_t function_arity(std::string_view fn) {
+    if (const FunctionDef* def = find_function(fn)) return def->arity;
+    raise({ErrorCode::INVALID_FUNCTION, 0, fn});
   }
-  bool is_operator(const std::string& op) { return operators.find(op) != operators.end(); }
-  bool is_operator(char op) { return is_operator(std::string(1, op)); }
-  bool is_unary(const std::string& op) { return op == "-" || op == "+"; }
-  bool is_unary(char op) { return is_unary(std::string(1, op)); }
-  bool is_right_associative(char op) { return is_right_associative(std::string(1, op)); }
-  OperatorPrec opprec(const std::string& op) { return operators[op]; }
-  bool is_right_associative(const std::string& op) {
-    if (op == "^" || op == "=") return true;
-    return false;
+
+  template <typename T>
+  [[nodiscard]] T apply_operator(std::string_view op, T left, T right) {
+    switch (op.size() == 1 ? op[0] : '\0') {
+      case '+': return left + right;
+      case '-': return left - right;
+      case '*': return left * right;
+      case '/': {
+        if (right == 0) raise({ErrorCode::DIVISION_BY_ZERO});
+        return left / right;
+      }
+      case '^': return std::pow(left, right);
+      default: raise({ErrorCode::INVALID_OPERATOR, 0, op});
+    }
   }
-  [[nodiscard]] float apply_operator(const std::string& op, float left, float right) {
-    if (op == "+") return left + right;
-    if (op == "-") return left - right;
-    if (op == "*") return left * right;
-    if (op == "/") {
-      if (right == 0) throw std::logic_error("Division by zero");
-      return left / right;
+
+  namespace { // math routines behind every entry of the functions table
+    template <typename T> T fn_sqrt(const T* a) { return std::sqrt(a[0]); }
+    template <typename T> T fn_pow(const T* a) { return std::pow(a[0], a[1]); }
+    template <typename T> T fn_cos(const T* a) { return std::cos(a[0]); }
+    template <typename T> T fn_sin(const T* a) { return std::sin(a[0]); }
+    template <typename T> T fn_max(const T* a) { return std::fmax(a[0], a[1]); }
+    template <typename T> T fn_min(const T* a) { return std::fmin(a[0], a[1]); }
+    template <typename T> T fn_abs(const T* a) { return std::fabs(a[0]); }
+    template <typename T> T fn_exp(const T* a) { return std::exp(a[0]); }
+    template <typename T> T fn_log(const T* a) {
+      if (auto error = domain_error(Function::LOG, a)) raise({*error});
+      return std::log(a[0]);
+    }
+    template <typename T> T fn_floor(const T* a) { return std::floor(a[0]); }
+    template <typename T> T fn_ceil(const T* a) { return std::ceil(a[0]); }
+    template <typename T> T fn_round(const T* a) { return std::round(a[0]); }
+    template <typename T> T fn_sign(const T* a) { return (a[0] > 0) - (a[0] < 0); }
+    template <typename T> T fn_hypot(const T* a) { return std::hypot(a[0], a[1]); }
+    template <typename T> T fn_atan2(const T* a) { return std::atan2(a[0], a[1]); }
+    template <typename T> T fn_sinh(const T* a) { return std::sinh(a[0]); }
+    template <typename T> T fn_cosh(const T* a) { return std::cosh(a[0]); }
+    template <typename T> T fn_tanh(const T* a) { return std::tanh(a[0]); }
+    template <typename T> T fn_asinh(const T* a) { return std::asinh(a[0]); }
+    template <typename T> T fn_acosh(const T* a) {
+      if (auto error = domain_error(Function::ACOSH, a)) raise({*error});
+      return std::acosh(a[0]);
+    }
+    template <typename T> T fn_atanh(const T* a) {
+      if (auto error = domain_error(Function::ATANH, a)) raise({*error});
+      return std::atanh(a[0]);
     }
-    if (op == "^") return std::pow(left, right);
-    throw std::logic_error(fmt::format("Invalid operator: {}", op));
   }
-  [[nodiscard]] float apply_function(const std::string& fn, const std::vector<float>& args) {
-    if (fn == "sqrt") return std::sqrt(args[0]);
-    if (fn == "pow") return std::pow(args[0], args[1]);
-    if (fn == "cos") return std::cos(args[0]);
-    if (fn == "sin") return std::sin(args[0]);
-    if (fn == "max") return std::fmax(args[0], args[1]);
-    if (fn == "min") return std::fmin(args[0], args[1]);
-    if (fn == "abs") return std::fabs(args[0]);
-    if (fn == "exp") return std::exp(args[0]);
-    if (fn == "log" || fn == "ln") {
-      if (args[0] <= 0) throw std::logic_error("Logarithm of non-positive number");
-      return std::log(args[0]);
+
+  // math routines indexed by Function, built at compile time for each scalar type
+  template <typename T>
+  constexpr std::array<FunctionPtr<T>, functions.size()> math_table = {
+    fn_sqrt<T>, fn_pow<T>, fn_cos<T>, fn_sin<T>, fn_max<T>, fn_min<T>, fn_abs<T>, fn_exp<T>,
+    fn_log<T>, fn_log<T>, fn_floor<T>, fn_ceil<T>, fn_round<T>, fn_sign<T>, fn_hypot<T>, fn_atan2<T>,
+    fn_sinh<T>, fn_cosh<T>, fn_tanh<T>, fn_asinh<T>, fn_acosh<T>, fn_atanh<T>,
+  };
+
+  namespace { // partial derivatives of every entry of the functions table, with respect to each argument
+    template <typename T> void d_sqrt(const T*, T v, T* p) { p[0] = 1 / (2 * v); }
+    template <typename T> void d_pow(const T* a, T v, T* p) {
+      p[0] = a[1] == 0 ? T{0} : a[1] * std::pow(a[0], a[1] - 1);
+      // NaN for negative bases, only used if the exponent varies. 0^b is flat in b where it's 0, not 0 * -inf
+      p[1] = a[0] == 0 && v == 0 ? T{0} : v * std::log(a[0]);
     }
-    if (fn == "floor") return std::floor(args[0]);
-    if (fn == "ceil") return std::ceil(args[0]);
-    if (fn == "round") return std::round(args[0]);
-    if (fn == "sign") return (args[0] > 0) - (args[0] < 0);
-    if (fn == "hypot") return std::hypot(args[0], args[1]);
-    if (fn == "atan2") return std::atan2(args[0], args[1]);
-    if (fn == "sinh") return std::sinh(args[0]);
-    if (fn == "cosh") return std::cosh(args[0]);
-    if (fn == "tanh") return std::tanh(args[0]);
-    if (fn == "asinh") return std::asinh(args[0]);
-    if (fn == "acosh") {
-      if (args[0] < 1) throw std::logic_error("Inverse hyperbolic cosine of number less than 1");
-      return std::acosh(args[0]);
+    template <typename T> void d_cos(const T* a, T, T* p) { p[0] = -std::sin(a[0]); }
+    template <typename T> void d_sin(const T* a, T, T* p) { p[0] = std::cos(a[0]); }
+    template <typename T> void d_max(const T* a, T, T* p) { p[0] = a[0] >= a[1]; p[1] = 1 - p[0]; }
+    template <typename T> void d_min(const T* a, T, T* p) { p[0] = a[0] <= a[1]; p[1] = 1 - p[0]; }
+    template <typename T> void d_abs(const T* a, T, T* p) { p[0] = (a[0] > 0) - (a[0] < 0); }
+    template <typename T> void d_exp(const T*, T v, T* p) { p[0] = v; }
+    template <typename T> void d_log(const T* a, T, T* p) { p[0] = 1 / a[0]; }
+    template <typename T> void d_step(const T*, T, T* p) { p[0] = 0; } // floor, ceil, round and sign are piecewise constant
+    template <typename T> void d_hypot(const T* a, T v, T* p) {
+      p[0] = v == 0 ? T{0} : a[0] / v;
+      p[1] = v == 0 ? T{0} : a[1] / v;
     }
-    if (fn == "atanh") {
-      if (args[0] <= -1 || args[0] >= 1) throw std::logic_error("Inverse hyperbolic tangent of number outside the range (-1, 1)");
-      return std::atanh(args[0]);
+    template <typename T> void d_atan2(const T* a, T, T* p) {
+      const T r = a[0] * a[0] + a[1] * a[1];
+      p[0] = r == 0 ? T{0} : a[1] / r;
+      p[1] = r == 0 ? T{0} : -a[0] / r;
     }
-    throw std::logic_error(fmt::format("Invalid function: {}", fn));
+    template <typename T> void d_sinh(const T* a, T, T* p) { p[0] = std::cosh(a[0]); }
+    template <typename T> void d_cosh(const T* a, T, T* p) { p[0] = std::sinh(a[0]); }
+    template <typename T> void d_tanh(const T*, T v, T* p) { p[0] = 1 - v * v; }
+    template <typename T> void d_asinh(const T* a, T, T* p) { p[0] = 1 / std::sqrt(a[0] * a[0] + 1); }
+    template <typename T> void d_acosh(const T* a, T, T* p) { p[0] = 1 / std::sqrt(a[0] * a[0] - 1); }
+    template <typename T> void d_atanh(const T* a, T, T* p) { p[0] = 1 / (1 - a[0] * a[0]); }
   }
+
+  // derivative rules indexed by Function, like math_table
+  template <typename T>
+  constexpr std::array<DerivativePtr<T>, functions.size()> derivative_table = {
+    d_sqrt<T>, d_pow<T>, d_cos<T>, d_sin<T>, d_max<T>, d_min<T>, d_abs<T>, d_exp<T>,
+    d_log<T>, d_log<T>, d_step<T>, d_step<T>, d_step<T>, d_step<T>, d_hypot<T>, d_atan2<T>,
+    d_sinh<T>, d_cosh<T>, d_tanh<T>, d_asinh<T>, d_acosh<T>, d_atanh<T>,
+  };
+
+#if defined(SYA_ENABLE_STATS)
+  namespace { // count the call, then forward to the math routine
+    template <typename T, std::size_t I>
+    T counted(const T* args) {
+      SYA_STATS_CALL(static_cast<Function>(I));
+      return math_table<T>[I](args);
+    }
+
+    template <typename T, std::size_t... I>
+    constexpr std::array<FunctionPtr<T>, sizeof...(I)> counted_table(std::index_sequence<I...>) { return { counted<T, I>... }; }
+  }
+
+  // function tables every caller goes through: apply_function(), compiled programs and constant folding
+  template <typename T>
+  constexpr std::array<FunctionPtr<T>, functions.size()> function_table = counted_table<T>(std::make_index_sequence<functions.size()>());
+#else
+  template <typename T>
+  constexpr const std::array<FunctionPtr<T>, functions.size()>& function_table = math_table<T>;
+#endif
+
+  template <typename T>
+  [[nodiscard]] FunctionPtr<T> resolve_function(Function fn) noexcept {
+    return function_table<T>[static_cast<std::size_t>(fn)];
+  }
+  template <typename T>
+  [[nodiscard]] FunctionPtr<T> resolve_function(std::string_view fn) {
+    if (const FunctionDef* def = find_function(fn)) return resolve_function<T>(def->id);
+    raise({ErrorCode::INVALID_FUNCTION, 0, fn});
+  }
+  template <typename T>
+  [[nodiscard]] DerivativePtr<T> resolve_derivative(Function fn) noexcept {
+    return derivative_table<T>[static_cast<std::size_t>(fn)];
+  }
+  template <typename T>
+  [[nodiscard]] T apply_function(std::string_view fn, std::span<const T> args) {
+    return resolve_function<T>(fn)(args.data());
+  }
+
+  template float apply_operator<float>(std::string_view, float, float);
+  template double apply_operator<double>(std::string_view, double, double);
+  template long double apply_operator<long double>(std::string_view, long double, long double);
+
+  template float apply_function<float>(std::string_view, std::span<const float>);
+  template double apply_function<double>(std::string_view, std::span<const double>);
+  template long double apply_function<long double>(std::string_view, std::span<const long double>);
+
+  template FunctionPtr<float> resolve_function<float>(Function) noexcept;
+  template FunctionPtr<double> resolve_function<double>(Function) noexcept;
+  template FunctionPtr<long double> resolve_function<long double>(Function) noexcept;
+
+  template FunctionPtr<float> resolve_function<float>(std::string_view);
+  template FunctionPtr<double> resolve_function<double>(std::string_view);
+  template FunctionPtr<long double> resolve_function<long double>(std::string_view);
+
+  template DerivativePtr<float> resolve_derivative<float>(Function) noexcept;
+  template DerivativePtr<double> resolve_derivative<double>(Function) noexcept;
+  template DerivativePtr<long double> resolve_derivative<long double>(Function) noexcept;
 }
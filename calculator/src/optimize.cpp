@@ -0,0 +1,244 @@
+#include "optimize.hpp"
+#include "operator.hpp"
+#include "variable.hpp"
+
+#include <cmath>    // for std::isnan, std::signbit
+#include <iterator> // for std::back_inserter
+#include <map>      // for std::map
+#include <vector>
+#include <fmt/format.h>
+
+namespace sya {
+  template <typename T>
+  std::size_t fold_constants(Expression& rpn_expr) {
+    using tt = TokenType;
+
+    struct Entry {
+      bool constant; // if the subtree only depends on literals and constants
+      T value;       // its value, when constant
+      size_t start;  // index of the first output token of the subtree
+    };
+
+    struct Folded {
+      size_t at; // index of the literal in the output
+      T value;
+    };
+
+    // the output is written over the input: a token is read before anything is written at its index,
+    // since folding only ever shortens the expression
+    size_t size = 0;
+    std::vector<Entry> stack; // the evaluation stack, simulated over subtrees
+    std::vector<Folded> folded; // literals folded so far, by index, formatted once the expression is done
+    std::vector<T> args;
+    std::size_t removed = 0;
+
+    // replace the output tokens of the subtree starting at `start` with a single literal
+    auto fold = [&](size_t start, T value) {
+      removed += size - start - 1;
+      size = start + 1;
+      while (!folded.empty() && folded.back().at >= start) folded.pop_back(); // folded again, never formatted
+      folded.push_back({start, value});
+      stack.push_back({true, value, start});
+    };
+
+    for (size_t i = 0; i < rpn_expr.size(); i++) {
+      const size_t start = size;
+      if (i != size) rpn_expr[size] = std::move(rpn_expr[i]);
+      const Token& token = rpn_expr[size++];
+
+      switch (token.type()) {
+        case tt::NUMBER: {
+          T value{};
+          const bool parsed = utils::parse_number(token.view(), value) == std::errc(); // or left for compile() to report
+          stack.push_back({parsed, value, start});
+          continue;
+        }
+        case tt::VARIABLE: {
+          if ((i + 1) < rpn_expr.size() && rpn_expr[i + 1].type() == tt::OPERATOR && rpn_expr[i + 1].view() == "=") {
+            if (!stack.empty()) stack.back().constant = false; // never fold a subtree across an assignment
+            continue;
+          }
+
+          // constants are only replaced by their value when they end up folded with something else
+          const Constant* c = find_constant(token.view());
+          stack.push_back({c != nullptr, c ? static_cast<T>(c->value) : T{}, start});
+          continue;
+        }
+        case tt::OPERATOR: {
+          if (token.view() == "=") continue;
+          if (stack.size() < 2) break; // malformed, left for compile() to report
+
+          Entry right = stack.back(); stack.pop_back();
+          Entry left = stack.back(); stack.pop_back();
+          const bool fails = token.view() == "/" && right.value == 0; // left for evaluation to report
+          if (left.constant && right.constant && !fails) fold(left.start, apply_operator(token.view(), left.value, right.value));
+          else stack.push_back({false, T{}, left.start});
+          continue;
+        }
+        case tt::FUNCTION: {
+          const FunctionDef* def = find_function(token.view());
+          if (!def || stack.size() < def->arity) break;
+
+          bool constant = true;
+          args.assign(def->arity, T{});
+          for (size_t k = def->arity; k-- > 0;) {
+            constant = constant && stack.back().constant;
+            args[k] = stack.back().value;
+            if (k != 0) stack.pop_back();
+          }
+          Entry first = stack.back(); stack.pop_back();
+
+          if (constant && !domain_error(def->id, args.data())) fold(first.start, resolve_function<T>(def->id)(args.data()));
+          else stack.push_back({false, T{}, first.start});
+          continue;
+        }
+        default: break;
+      }
+
+      // the expression can't be simulated any further, keep the remaining tokens as they are
+      for (size_t j = i + 1; j < rpn_expr.size(); j++) rpn_expr[size++] = std::move(rpn_expr[j]);
+      break;
+    }
+
+    while (rpn_expr.size() > size) rpn_expr.pop();
+
+    // shortest representation that parses back to the same value
+    fmt::memory_buffer text;
+    for (const Folded& f : folded) {
+      text.clear();
+      fmt::format_to(std::back_inserter(text), "{}", f.value);
+      rpn_expr[f.at] = Token({text.data(), text.size()}, tt::NUMBER);
+    }
+    return removed;
+  }
+
+  template <typename T>
+  CseStats share_subexpressions(BasicProgram<T>& program) {
+    CseStats stats{program.code.size(), program.code.size(), 0};
+    if (program.temps != 0) return stats;
+
+    bool stored = false; // a load after a store may read a different value than the same load before it
+    for (const Instruction& in : program.code) {
+      if (in.op == OpCode::STORE) stored = true;
+      else if (in.op == OpCode::LOAD && stored) return stats;
+    }
+
+    constexpr std::size_t none = static_cast<std::size_t>(-1);
+    struct Node {
+      Instruction in;
+      std::vector<std::size_t> children;
+      std::size_t uses = 0;    // references from parents and from the final stack
+      std::size_t temp = none; // temporary holding its value, once emitted
+    };
+
+    std::vector<Node> nodes;
+    std::map<std::vector<std::size_t>, std::size_t> index; // (op, canonical operand, children...) -> node
+    std::map<std::pair<bool, T>, std::size_t> literal_ids;  // equal literals share a node, -0 and 0 don't
+    std::vector<std::size_t> stack; // the evaluation stack, simulated over nodes
+
+    for (const Instruction& in : program.code) {
+      std::size_t operand = in.arg;
+      std::size_t pops = 0;
+      switch (in.op) {
+        case OpCode::PUSH: {
+          const T value = program.literals[in.arg];
+          // NaN compares equal to nothing and would break the map's ordering, each NaN literal keeps its own node
+          if (!std::isnan(value)) operand = literal_ids.try_emplace({std::signbit(value), value}, in.arg).first->second;
+          break;
+        }
+        case OpCode::LOAD: break;
+        case OpCode::STORE: pops = 1; break;
+        case OpCode::ADD: case OpCode::SUB: case OpCode::MUL: case OpCode::DIV: case OpCode::POW: pops = 2; break;
+        case OpCode::CALL: {
+          operand = static_cast<std::size_t>(program.calls[in.arg]); // same function, whatever its index
+          pops = in.arity;
+          break;
+        }
+        case OpCode::SAVE: case OpCode::RECALL: return stats; // unreachable, temps is 0
+      }
+      if (stack.size() < pops) return stats; // malformed, left as compiled
+
+      std::vector<std::size_t> key{static_cast<std::size_t>(in.op), operand, in.arity};
+      key.insert(key.end(), stack.end() - pops, stack.end());
+      stack.resize(stack.size() - pops);
+
+      std::size_t id = nodes.size();
+      if (in.op == OpCode::STORE) nodes.push_back({in, {key.begin() + 3, key.end()}}); // side effects are never shared
+      else {
+        auto [it, inserted] = index.try_emplace(std::move(key), id);
+        if (inserted) nodes.push_back({in, {it->first.begin() + 3, it->first.end()}});
+        id = it->second;
+      }
+      stack.push_back(id);
+    }
+
+    for (const Node& node : nodes)
+      for (std::size_t child : node.children) nodes[child].uses++;
+    for (std::size_t root : stack) nodes[root].uses++;
+
+    // re-emit in post-order, starting from the roots left on the stack
+    std::vector<Instruction> code;
+    std::vector<std::pair<std::size_t, std::size_t>> work; // (node, children already emitted)
+    code.reserve(program.code.size());
+
+    for (std::size_t root : stack) {
+      work.push_back({root, 0});
+      while (!work.empty()) {
+        auto& [id, next] = work.back();
+        Node& node = nodes[id];
+
+        if (node.temp != none) { // already computed
+          code.push_back({OpCode::RECALL, 0, static_cast<uint32_t>(node.temp)});
+          work.pop_back();
+        } else if (next < node.children.size()) {
+          work.push_back({node.children[next++], 0});
+        } else {
+          code.push_back(node.in);
+          const bool leaf = node.in.op == OpCode::PUSH || node.in.op == OpCode::LOAD; // cheaper to redo than to recall
+          if (node.uses > 1 && !leaf) {
+            node.temp = stats.shared++;
+            code.push_back({OpCode::SAVE, 0, static_cast<uint32_t>(node.temp)});
+          }
+          work.pop_back();
+        }
+      }
+    }
+
+    std::size_t depth = 0;
+    program.depth = 0;
+    for (const Instruction& in : code) {
+      switch (in.op) {
+        case OpCode::PUSH: case OpCode::LOAD: case OpCode::RECALL: depth++; break;
+        case OpCode::ADD: case OpCode::SUB: case OpCode::MUL: case OpCode::DIV: case OpCode::POW: depth--; break;
+        case OpCode::CALL: depth = depth - in.arity + 1; break;
+        case OpCode::STORE: case OpCode::SAVE: break;
+      }
+      program.depth = std::max(program.depth, depth);
+    }
+
+    program.code = std::move(code);
+    program.temps = stats.shared;
+    stats.after = nodes.size();
+    return stats;
+  }
+
+  template <typename T>
+  [[nodiscard]] BasicProgram<T> compile_shared(const Expression& rpn_expr, CseStats* stats) {
+    auto program = compile<T>(rpn_expr);
+    auto result = share_subexpressions(program);
+    if (stats) *stats = result;
+    return program;
+  }
+
+  template std::size_t fold_constants<float>(Expression&);
+  template std::size_t fold_constants<double>(Expression&);
+  template std::size_t fold_constants<long double>(Expression&);
+
+  template CseStats share_subexpressions<float>(BasicProgram<float>&);
+  template CseStats share_subexpressions<double>(BasicProgram<double>&);
+  template CseStats share_subexpressions<long double>(BasicProgram<long double>&);
+
+  template BasicProgram<float> compile_shared<float>(const Expression&, CseStats*);
+  template BasicProgram<double> compile_shared<double>(const Expression&, CseStats*);
+  template BasicProgram<long double> compile_shared<long double>(const Expression&, CseStats*);
+}
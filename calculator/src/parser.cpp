@@ -0,0 +1,202 @@
+#include "parser.hpp"
+#include "lexer.hpp"
+#include "logic.hpp"
+#include "operator.hpp"
+#include "stats.hpp"
+
+#include <optional> // for std::optional
+#include <utility>  // for std::move
+
+namespace sya {
+  namespace {
+    using tt = TokenType;
+
+    constexpr int lowest = static_cast<int>(OperatorPrec::ADD_SUB);
+
+    // the lexemes of an expression tokenized beforehand, which reported the lexer's errors already
+    class TokenSource {
+      private:
+      const Expression& m_tokens;
+      std::size_t m_index = 0;
+      std::optional<Error> m_error; // never set
+
+      public:
+      explicit TokenSource(const Expression& tokens) noexcept : m_tokens(tokens) {}
+
+      [[nodiscard]] std::optional<Lexeme> next() noexcept {
+        if (m_index == m_tokens.size()) return std::nullopt;
+        const Token& token = m_tokens[m_index++];
+        return Lexeme{token.view(), token.type(), token.position()};
+      }
+      [[nodiscard]] const std::optional<Error>& error() const noexcept { return m_error; }
+    };
+
+    // every rule returns false once an error is recorded, so that it unwinds without exceptions.
+    // Source is the Lexer of the source expression, or a TokenSource for to_rpn()
+    template <typename Source>
+    class Parser {
+      private:
+      std::string_view m_src;
+      Source m_lexer;
+      std::optional<Lexeme> m_next; // one lexeme of lookahead, std::nullopt at the end
+      Expression& m_out;
+      std::optional<Error> m_error;
+
+      [[nodiscard]] bool at(TokenType type) const noexcept { return m_next && m_next->type == type; }
+      [[nodiscard]] bool at_assignment() const noexcept { return at(tt::OPERATOR) && m_next->text == "="; }
+
+      Lexeme advance() {
+        Lexeme lexeme = *m_next;
+        m_next = m_lexer.next();
+        return lexeme;
+      }
+      void emit(const Lexeme& lexeme) { m_out.push(lexeme.text, lexeme.type, lexeme.position); }
+
+      // 1-based position of the next lexeme in the source, past its end if there is none
+      [[nodiscard]] uint32_t position() const noexcept {
+        if (!m_next) return m_src.empty() ? 0 : static_cast<uint32_t>(m_src.size() + 1); // no source for to_rpn()
+        return m_next->position;
+      }
+
+      // the lexer errors come first, as when the whole expression was tokenized before being converted
+      bool fail(ErrorCode code, std::string_view text = {}) {
+        Error error{code, position(), text};
+        while (m_lexer.next()) {}
+        m_error = m_lexer.error() ? *m_lexer.error() : error;
+        return false;
+      }
+
+      bool operand() { // a literal, a variable, a call or a parenthesized expression
+        if (!m_next || at(tt::OPERATOR)) // nothing after an operator, or nothing before it
+          return fail(ErrorCode::OPERATOR_AT_BOUNDARY);
+
+        switch (m_next->type) {
+          case tt::NUMBER: case tt::VARIABLE: emit(advance()); return true;
+          case tt::FUNCTION: return call();
+          case tt::OPEN_PARENT: {
+            advance();
+            if (!expression(lowest)) return false;
+            if (at(tt::SEPARATOR)) return fail(ErrorCode::SEPARATOR_OUTSIDE_FUNCTION);
+            return close();
+          }
+          case tt::CLOSE_PARENT: case tt::SEPARATOR: return fail(ErrorCode::MISSING_OPERAND);
+          default: return fail(ErrorCode::INVALID_TOKEN);
+        }
+      }
+
+      bool call() {
+        Lexeme fn = advance();
+        if (!at(tt::OPEN_PARENT)) return fail(ErrorCode::MISMATCHED_PARENTHESES);
+        advance();
+
+        std::size_t arg_count = 1; // "f()" is rejected by the lexer
+        if (!expression(lowest)) return false;
+        while (at(tt::SEPARATOR)) {
+          advance();
+          if (!expression(lowest)) return false;
+          arg_count++;
+        }
+        if (!close()) return false;
+
+        const FunctionDef* def = find_function(fn.text); // the lexer only makes FUNCTION lexemes of known names
+        if (def->arity != arg_count) {
+          fail(ErrorCode::ARGUMENT_COUNT, fn.text);
+          if (m_error->code == ErrorCode::ARGUMENT_COUNT) {
+            m_error->position = fn.position; // where its text is
+            m_error->expected = static_cast<uint16_t>(def->arity);
+            m_error->got = static_cast<uint16_t>(arg_count);
+          }
+          return false;
+        }
+        emit(fn);
+        return true;
+      }
+
+      bool close() {
+        if (!m_next) return fail(ErrorCode::MISMATCHED_PARENTHESES);
+        if (!at(tt::CLOSE_PARENT)) return fail(ErrorCode::TOO_MANY_OPERANDS);
+        advance();
+        return true;
+      }
+
+      // the operators following an operand, while they bind at least as tightly as `min`
+      bool infix(int min) {
+        while (at(tt::OPERATOR)) {
+          if (at_assignment()) return fail(ErrorCode::INVALID_ASSIGNMENT);
+
+          const int prec = static_cast<int>(opprec(m_next->text));
+          if (prec < min) break;
+
+          Lexeme op = advance();
+          if (!m_next && is_unary(op.text)) // a trailing sign, like "2+"
+            return fail(ErrorCode::MISSING_OPERAND);
+          if (!expression(is_right_associative(op.text) ? prec : prec + 1)) return false;
+          emit(op);
+        }
+        return true;
+      }
+
+      bool expression(int min) { return operand() && infix(min); }
+
+      public:
+      Parser(std::string_view src, Source source, Expression& out) : m_src(src), m_lexer(std::move(source)), m_out(out) { m_next = m_lexer.next(); }
+
+      [[nodiscard]] const std::optional<Error>& error() const noexcept { return m_error; }
+
+      bool statement(std::pmr::memory_resource* resource) {
+        if (!m_next) return fail(ErrorCode::EMPTY_EXPRESSION);
+
+        std::pmr::vector<Lexeme> targets(resource); // assigned variables, in source order
+        bool parsed = false;
+        while (!parsed && at(tt::VARIABLE)) {
+          Lexeme var = advance();
+          if (at_assignment()) {
+            advance();
+            targets.push_back(var);
+          } else { // the variable starts the expression
+            emit(var);
+            if (!infix(lowest)) return false;
+            parsed = true;
+          }
+        }
+        if (!parsed && !expression(lowest)) return false;
+
+        // a lexer error also ends the lexemes early, what was parsed is only a prefix
+        if (m_next || m_lexer.error()) return fail(ErrorCode::TOO_MANY_OPERANDS);
+
+        // the right-most assignment happens first
+        for (auto it = targets.rbegin(); it != targets.rend(); ++it) {
+          emit(*it);
+          m_out.push("=", tt::OPERATOR);
+        }
+        return true;
+      }
+    };
+  }
+
+  [[nodiscard]] Result<Expression> try_parse(std::string_view expr, std::pmr::memory_resource* resource) {
+    SYA_STATS_TIME(PARSE);
+    Expression output(resource);
+    output.reserve(expr.size() + 1); // usually enough, the RPN has no parentheses nor spaces
+
+    Parser<Lexer> parser(expr, Lexer(expr), output);
+    if (!parser.statement(resource)) return std::unexpected(*parser.error());
+    return output;
+  }
+
+  [[nodiscard]] Result<Expression> try_to_rpn(const Expression& expr, std::pmr::memory_resource* resource) {
+    SYA_STATS_TIME(TO_RPN);
+    Expression output(resource);
+    output.reserve(expr.size()); // at most every token
+
+    Parser<TokenSource> parser({}, TokenSource(expr), output);
+    if (!parser.statement(resource)) return std::unexpected(*parser.error());
+    return output;
+  }
+
+  [[nodiscard]] Expression parse(std::string_view expr, std::pmr::memory_resource* resource) {
+    auto rpn = try_parse(expr, resource);
+    if (!rpn) raise(rpn.error());
+    return std::move(*rpn);
+  }
+}
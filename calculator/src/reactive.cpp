@@ -0,0 +1,128 @@
+#include "reactive.hpp"
+
+#include <algorithm> // for std::find, std::erase, std::reverse
+#include <stdexcept> // for std::logic_error
+#include <utility>   // for std::pair
+#include <fmt/core.h>
+
+namespace sya {
+  template <typename T>
+  std::vector<std::size_t> BasicDefinitionGraph<T>::assign(std::string_view source, const BasicProgram<T>& program, SymbolTable& table) {
+    if (program.symbols.size() != program.names.size()) throw std::logic_error("Invalid program: program is not bound to a symbol table");
+
+    Definition def{std::string(source), program, {}, {}};
+    for (std::size_t s = 0; s < program.names.size(); s++) {
+      if (program.inputs[s]) def.inputs.push_back(program.symbols[s]);
+      if (program.outputs[s]) def.outputs.push_back(program.symbols[s]);
+    }
+
+    // a cycle means an output is upstream of an input: walk the definitions of the inputs back
+    std::vector<std::size_t> pending = def.inputs;
+    std::vector<bool> seen(table.size(), false);
+    while (!pending.empty()) {
+      const std::size_t slot = pending.back();
+      pending.pop_back();
+      if (seen[slot]) continue;
+      seen[slot] = true;
+
+      if (std::find(def.outputs.begin(), def.outputs.end(), slot) != def.outputs.end())
+        throw std::logic_error(fmt::format("Cyclic definition: '{}' depends on itself", table.name(slot)));
+
+      if (auto owner = m_owner.find(slot); owner != m_owner.end()) {
+        const auto& inputs = m_definitions.at(owner->second).inputs;
+        pending.insert(pending.end(), inputs.begin(), inputs.end());
+      }
+    }
+
+    (void) evaluate(program, table); // throws before the graph changes
+
+    for (std::size_t slot : def.outputs) forget(slot); // a definition assigning several variables is dropped as a whole
+
+    const std::size_t id = m_next++;
+    for (std::size_t slot : def.inputs) m_readers[slot].push_back(id);
+    for (std::size_t slot : def.outputs) m_owner[slot] = id;
+    const auto outputs = def.outputs;
+    m_definitions.emplace(id, std::move(def));
+
+    std::vector<std::size_t> updated;
+    for (std::size_t dependent : affected(outputs)) {
+      const Definition& d = m_definitions.at(dependent);
+      try {
+        (void) evaluate(d.program, table);
+      }
+      catch (const std::exception& e) {
+        throw std::logic_error(fmt::format("Cannot update '{}': {}", table.name(d.outputs.front()), e.what()));
+      }
+      updated.insert(updated.end(), d.outputs.begin(), d.outputs.end());
+    }
+    return updated;
+  }
+
+  template <typename T>
+  std::vector<std::size_t> BasicDefinitionGraph<T>::affected(const std::vector<std::size_t>& slots) const {
+    std::vector<std::size_t> order; // reverse topological order, reversed at the end
+    std::unordered_map<std::size_t, bool> visited;
+    std::vector<std::pair<std::size_t, bool>> stack; // (definition, its dependents were pushed)
+
+    auto push_readers = [&](std::size_t slot) {
+      if (auto it = m_readers.find(slot); it != m_readers.end())
+        for (std::size_t reader : it->second)
+          if (!visited[reader]) stack.push_back({reader, false});
+    };
+
+    for (std::size_t slot : slots) push_readers(slot);
+    while (!stack.empty()) { // iterative depth-first post-order over the readers
+      auto [id, expanded] = stack.back();
+      stack.pop_back();
+
+      if (expanded) {
+        order.push_back(id);
+        continue;
+      }
+      if (visited[id]) continue;
+      visited[id] = true;
+
+      stack.push_back({id, true});
+      for (std::size_t slot : m_definitions.at(id).outputs) push_readers(slot);
+    }
+
+    std::reverse(order.begin(), order.end());
+    return order;
+  }
+
+  template <typename T>
+  void BasicDefinitionGraph<T>::drop(std::size_t id) noexcept {
+    auto it = m_definitions.find(id);
+    if (it == m_definitions.end()) return;
+
+    for (std::size_t slot : it->second.inputs) {
+      auto readers = m_readers.find(slot);
+      std::erase(readers->second, id);
+      if (readers->second.empty()) m_readers.erase(readers);
+    }
+    for (std::size_t slot : it->second.outputs) m_owner.erase(slot);
+    m_definitions.erase(it);
+  }
+
+  template <typename T>
+  void BasicDefinitionGraph<T>::forget(std::size_t slot) noexcept {
+    if (auto owner = m_owner.find(slot); owner != m_owner.end()) drop(owner->second);
+  }
+
+  template <typename T>
+  void BasicDefinitionGraph<T>::clear() noexcept {
+    m_definitions.clear();
+    m_owner.clear();
+    m_readers.clear();
+  }
+
+  template <typename T>
+  [[nodiscard]] auto BasicDefinitionGraph<T>::definition(std::size_t slot) const noexcept -> const Definition* {
+    auto owner = m_owner.find(slot);
+    return owner != m_owner.end() ? &m_definitions.at(owner->second) : nullptr;
+  }
+
+  template class BasicDefinitionGraph<float>;
+  template class BasicDefinitionGraph<double>;
+  template class BasicDefinitionGraph<long double>;
+}
@@ -0,0 +1,364 @@
+#include "reduce.hpp"
+#include "logic.hpp"
+#include "operator.hpp"
+#include "stats.hpp"
+#include "utils.hpp"
+
+#include <algorithm> // for std::min
+#include <charconv>  // for std::from_chars
+#include <cmath>     // for std::abs, std::ceil, std::floor, std::isfinite, std::isnan
+#include <limits>    // for std::numeric_limits
+#include <stdexcept> // for std::logic_error
+#include <vector>    // for std::vector
+#include <fmt/core.h>
+
+namespace sya {
+  namespace {
+    constexpr std::size_t chunk = 1 << 14; // points of one task, fixed so that results don't depend on the thread count
+    constexpr std::size_t pairwise_block = 128; // values summed in a plain loop by pairwise_sum()
+    constexpr std::size_t panels = 1 << 14; // Gauss-Legendre panels of integrate()
+    constexpr std::size_t max_terms = std::size_t(1) << 30; // of sum() and prod(), about a minute of evaluation on one thread
+    constexpr int root_iterations = 200;
+
+    // 5-point Gauss-Legendre nodes and weights on [-1, 1]
+    constexpr std::array<long double, 5> gauss_nodes = {
+      -0.906179845938663992797626878299392965L, -0.538469310105683091036314420700208805L, 0.0L,
+      0.538469310105683091036314420700208805L, 0.906179845938663992797626878299392965L,
+    };
+    constexpr std::array<long double, 5> gauss_weights = {
+      0.236926885056189087514264040719917363L, 0.478628670499366468041291514835638193L, 0.568888888888888888888888888888888889L,
+      0.478628670499366468041291514835638193L, 0.236926885056189087514264040719917363L,
+    };
+
+    std::string_view trim(std::string_view text) noexcept {
+      while (!text.empty() && utils::is_space(text.front())) text.remove_prefix(1);
+      while (!text.empty() && utils::is_space(text.back())) text.remove_suffix(1);
+      return text;
+    }
+
+    // reject what the lexer reads differently than written in an argument: a number in exponent notation,
+    // which it reads as a product ("1e8" is 1*e8), and a sign before a name, which it has no token for
+    void check_argument(const ReductionDef& def, std::string_view text) {
+      char last = '\0'; // previous character that isn't a space
+      for (std::size_t i = 0; i < text.size();) {
+        const char c = text[i];
+        if (utils::is_alpha(c)) { // a whole name, digits included
+          while (i < text.size() && (utils::is_alnum(text[i]) || text[i] == '_')) i++;
+          last = c;
+          continue;
+        }
+        if (utils::is_digit(c) || c == '.') {
+          const std::size_t start = i;
+          while (i < text.size() && (utils::is_digit(text[i]) || text[i] == '.')) i++;
+          std::size_t end = i + 1;
+          if (end < text.size() && (text[end] == '+' || text[end] == '-')) end++;
+          if (i < text.size() && (text[i] == 'e' || text[i] == 'E') && end < text.size() && utils::is_digit(text[end])) {
+            while (end < text.size() && utils::is_digit(text[end])) end++;
+            throw std::logic_error(fmt::format("Invalid {}: exponent notation like '{}' is only supported in bounds written as a number",
+                                               def.name, text.substr(start, end - start)));
+          }
+          last = c;
+          continue;
+        }
+        if ((c == '-' || c == '+') && (last == '\0' || last == '(' || last == ',' || is_operator(last)) &&
+            i + 1 < text.size() && utils::is_alpha(text[i + 1])) {
+          std::size_t end = i + 1;
+          while (end < text.size() && (utils::is_alnum(text[end]) || text[end] == '_')) end++;
+          throw std::logic_error(fmt::format("Invalid {}: a sign before a name like '{}' isn't supported, write {}1*{}",
+                                             def.name, text.substr(i, end - i), c, text.substr(i + 1, end - i - 1)));
+        }
+        if (!utils::is_space(c)) last = c;
+        i++;
+      }
+    }
+
+    // the error grows with log(n) instead of n, and the loops over blocks still vectorize
+    template <typename T>
+    T pairwise_sum(const T* values, std::size_t n) {
+      if (n <= pairwise_block) {
+        T sum{};
+        for (std::size_t i = 0; i < n; i++) sum += values[i];
+        return sum;
+      }
+      const std::size_t half = n / 2;
+      return pairwise_sum(values, half) + pairwise_sum(values + half, n - half);
+    }
+
+    // Neumaier's variant of Kahan summation, for the partial results of the chunks
+    template <typename T>
+    T compensated_sum(const std::vector<T>& values) {
+      T sum{}, compensation{};
+      for (T v : values) {
+        const T t = sum + v;
+        compensation += std::abs(sum) >= std::abs(v) ? (sum - t) + v : (v - t) + sum;
+        sum = t;
+      }
+      return sum + compensation;
+    }
+
+    // evaluate the body at `count` points, point(k) being the value of `var` at the k-th one, and reduce every
+    // chunk of values with fold(first, values, n). Chunks run on the pool, their results are returned in order
+    template <typename T, typename Point, typename Fold>
+    std::vector<T> map_chunks(const BasicProgram<T>& body, std::string_view var, std::size_t count, Point point, Fold fold,
+                              const SymbolTable& table, ThreadPool* pool) {
+      const std::size_t chunks = (count + chunk - 1) / chunk;
+      std::vector<T> results(chunks);
+
+      auto run = [&](std::size_t c) {
+        const std::size_t first = c * chunk;
+        const std::size_t n = std::min(chunk, count - first);
+
+        std::vector<T> points(n), values(n);
+        for (std::size_t k = 0; k < n; k++) points[k] = point(first + k);
+
+        const BasicColumn<T> column{var, points};
+        evaluate_batch(body, std::span<const BasicColumn<T>>(&column, 1), std::span<T>(values), table);
+        results[c] = fold(first, values.data(), n);
+      };
+
+      if (!pool || chunks < 2) {
+        for (std::size_t c = 0; c < chunks; c++) run(c);
+      } else {
+        for (std::size_t c = 0; c < chunks; c++) pool->submit([&run, c](std::size_t) { run(c); });
+        pool->wait();
+      }
+      return results;
+    }
+
+    // the checks of try_evaluate() over a bound program, for every variable but the bound one
+    template <typename T>
+    void check_inputs(const BasicProgram<T>& body, std::string_view var, const SymbolTable& table) {
+      if (body.symbols.size() != body.names.size()) throw std::logic_error("Invalid program: program is not bound to a symbol table");
+      for (std::size_t s = 0; s < body.names.size(); s++)
+        if (body.names[s] != var && !table.defined(body.symbols[s]))
+          raise({ErrorCode::UNDEFINED_VARIABLE, body.positions[s], body.names[s]});
+    }
+
+    // number of integers in [lo, hi], which every evaluated point is one of
+    template <typename T>
+    std::size_t integer_count(T lo, T hi) {
+      if (!std::isfinite(lo) || !std::isfinite(hi)) throw std::logic_error("Invalid range: bounds must be finite");
+      const long double first = std::ceil(static_cast<long double>(lo)), last = std::floor(static_cast<long double>(hi));
+      if (last < first) return 0;
+      if (last - first >= static_cast<long double>(max_terms)) throw std::logic_error("Invalid range: too many terms");
+      return static_cast<std::size_t>(last - first) + 1;
+    }
+
+    template <typename T>
+    T sum(const BasicProgram<T>& body, std::string_view var, T lo, T hi, const SymbolTable& table, ThreadPool* pool) {
+      const std::size_t count = integer_count(lo, hi);
+      const T first = std::ceil(lo);
+      auto partials = map_chunks(body, var, count, [&](std::size_t k) { return first + static_cast<T>(k); },
+                                 [](std::size_t, const T* values, std::size_t n) { return pairwise_sum(values, n); },
+                                 table, pool);
+      return compensated_sum(partials);
+    }
+
+    template <typename T>
+    T prod(const BasicProgram<T>& body, std::string_view var, T lo, T hi, const SymbolTable& table, ThreadPool* pool) {
+      const std::size_t count = integer_count(lo, hi);
+      const T first = std::ceil(lo);
+      auto partials = map_chunks(body, var, count, [&](std::size_t k) { return first + static_cast<T>(k); },
+                                 [](std::size_t, const T* values, std::size_t n) {
+                                   T product{1};
+                                   for (std::size_t i = 0; i < n; i++) product *= values[i];
+                                   return product;
+                                 }, table, pool);
+
+      T product{1};
+      for (T p : partials) product *= p;
+      return product;
+    }
+
+    template <typename T>
+    T integrate(const BasicProgram<T>& body, std::string_view var, T lo, T hi, const SymbolTable& table, ThreadPool* pool) {
+      if (!std::isfinite(lo) || !std::isfinite(hi)) throw std::logic_error("Invalid range: bounds must be finite");
+
+      const long double width = (static_cast<long double>(hi) - lo) / panels; // negative if hi < lo, as the integral
+      auto point = [&](std::size_t k) {
+        const long double panel = static_cast<long double>(k / gauss_nodes.size()) + 0.5L;
+        return static_cast<T>(lo + width * (panel + 0.5L * gauss_nodes[k % gauss_nodes.size()]));
+      };
+      auto fold = [](std::size_t first, T* values, std::size_t n) {
+        for (std::size_t i = 0; i < n; i++) values[i] *= static_cast<T>(gauss_weights[(first + i) % gauss_weights.size()]);
+        return pairwise_sum(values, n);
+      };
+
+      auto partials = map_chunks(body, var, panels * gauss_nodes.size(), point, fold, table, pool);
+      return static_cast<T>(width / 2) * compensated_sum(partials);
+    }
+
+    // Brent's method: inverse quadratic interpolation and secant steps, falling back to bisection
+    // whenever they don't shrink the bracket fast enough
+    template <typename T>
+    T root(const BasicProgram<T>& body, std::string_view var, T lo, T hi, const SymbolTable& table) {
+      if (body.assigns) throw std::logic_error("Invalid root: assignments are not supported");
+
+      const auto values = table.values();
+      std::vector<double> slots(values.begin(), values.end()); // the table's, `var` is written in the copy
+      std::vector<std::size_t> bound; // slots of `var`
+      for (std::size_t s = 0; s < body.names.size(); s++)
+        if (body.names[s] == var) bound.push_back(body.symbols[s]);
+
+      auto f = [&](T x) {
+        for (auto s : bound) slots[s] = static_cast<double>(x);
+        const T y = *evaluate(body, std::span<double>(slots));
+        if (std::isnan(y)) throw std::logic_error(fmt::format("Invalid root: the expression is undefined at {} = {}", var, x));
+        return y;
+      };
+
+      T a = lo, b = hi, fa = f(a), fb = f(b);
+      if (fa == 0) return a;
+      if (fb == 0) return b;
+      if ((fa > 0) == (fb > 0)) throw std::logic_error("Invalid root: the expression must change sign between the bounds");
+
+      T c = b, fc = fb, d = b - a, e = d;
+      for (int i = 0; i < root_iterations; i++) {
+        if ((fb > 0) == (fc > 0)) { // keep the root between b and c
+          c = a; fc = fa;
+          d = e = b - a;
+        }
+        if (std::abs(fc) < std::abs(fb)) { // b is the best estimate
+          a = b; b = c; c = a;
+          fa = fb; fb = fc; fc = fa;
+        }
+
+        const T tol = 2 * std::numeric_limits<T>::epsilon() * std::abs(b) + std::numeric_limits<T>::min();
+        const T m = (c - b) / 2;
+        if (std::abs(m) <= tol || fb == 0) return b;
+
+        if (std::abs(e) >= tol && std::abs(fa) > std::abs(fb)) {
+          T p, q;
+          const T s = fb / fa;
+          if (a == c) { // secant
+            p = 2 * m * s;
+            q = 1 - s;
+          } else { // inverse quadratic interpolation
+            const T r = fb / fc;
+            q = fa / fc;
+            p = s * (2 * m * q * (q - r) - (b - a) * (r - 1));
+            q = (q - 1) * (r - 1) * (s - 1);
+          }
+          if (p > 0) q = -q;
+          else p = -p;
+
+          if (2 * p < std::min(3 * m * q - std::abs(tol * q), std::abs(e * q))) {
+            e = d;
+            d = p / q;
+          } else { // bisect
+            d = m;
+            e = m;
+          }
+        } else {
+          d = m;
+          e = m;
+        }
+
+        a = b;
+        fa = fb;
+        b += std::abs(d) > tol ? d : (m > 0 ? tol : -tol);
+        fb = f(b);
+      }
+      return b;
+    }
+  }
+
+  [[nodiscard]] std::optional<double> number_bound(std::string_view text) noexcept {
+    text = trim(text);
+    if (!utils::is_number(text)) return std::nullopt;
+    if (text.front() == '+') text.remove_prefix(1); // from_chars only takes a minus
+
+    double value = 0;
+    auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+    if (error != std::errc() || end != text.data() + text.size()) return std::nullopt;
+    return value;
+  }
+
+  [[nodiscard]] std::optional<ReductionCall> match_reduction(std::string_view expr) {
+    expr = trim(expr);
+
+    // a reduction is a whole line, any reduction name called past its start is part of another expression
+    for (std::size_t i = 0; i < expr.size();) {
+      if (!utils::is_alpha(expr[i])) {
+        i++;
+        continue;
+      }
+      const std::size_t start = i;
+      while (i < expr.size() && (utils::is_alnum(expr[i]) || expr[i] == '_')) i++;
+      const ReductionDef* def = find_reduction(expr.substr(start, i - start));
+      if (!def || start == 0) continue;
+
+      std::size_t next = i;
+      while (next < expr.size() && utils::is_space(expr[next])) next++;
+      if (next < expr.size() && expr[next] == '(')
+        throw std::logic_error(fmt::format("Invalid expression: {}() can't be part of another expression", def->name));
+    }
+
+    const std::size_t open = expr.find('(');
+    if (open == std::string_view::npos) return std::nullopt;
+    const ReductionDef* def = find_reduction(trim(expr.substr(0, open)));
+    if (!def) return std::nullopt;
+
+    // split the top-level arguments, up to the matching parenthesis
+    std::vector<std::string_view> args;
+    std::size_t depth = 0, start = open + 1, close = std::string_view::npos;
+    for (std::size_t i = open; i < expr.size() && close == std::string_view::npos; i++) {
+      if (expr[i] == '(') depth++;
+      else if (expr[i] == ')' && --depth == 0) close = i;
+      else if (expr[i] == ',' && depth == 1) {
+        args.push_back(trim(expr.substr(start, i - start)));
+        start = i + 1;
+      }
+    }
+
+    if (close == std::string_view::npos) throw std::logic_error("Invalid expression: mismatched parentheses");
+    if (close != expr.size() - 1)
+      throw std::logic_error(fmt::format("Invalid expression: {}() can't be part of another expression", def->name));
+
+    args.push_back(trim(expr.substr(start, close - start)));
+    if (args.size() != def->arity)
+      throw std::logic_error(fmt::format("Invalid function: argument count mismatch for {}(). Expected {}, got {}",
+                                         def->name, def->arity, args.size()));
+    if (!validate_variable_name(args[1]) || is_constant(args[1]) || is_function(args[1]))
+      throw std::logic_error(fmt::format("Invalid variable name: '{}'", args[1]));
+
+    check_argument(*def, args[0]);
+    for (std::size_t k = 2; k < args.size(); k++)
+      if (!number_bound(args[k])) check_argument(*def, args[k]);
+
+    return ReductionCall{def, args[0], args[1], args[2], args[3]};
+  }
+
+  template <typename T>
+  [[nodiscard]] T reduce(Reduction kind, const Expression& body, std::string_view var, T lo, T hi,
+                         SymbolTable& table, ThreadPool* pool) {
+    auto program = compile<T>(body);
+    bind(program, table);
+    return reduce(kind, program, var, lo, hi, table, pool);
+  }
+
+  template <typename T>
+  [[nodiscard]] T reduce(Reduction kind, const BasicProgram<T>& body, std::string_view var, T lo, T hi,
+                         const SymbolTable& table, ThreadPool* pool) {
+    SYA_STATS_TIME(EVALUATE);
+    check_inputs(body, var, table);
+    switch (kind) {
+      case Reduction::SUM: return sum(body, var, lo, hi, table, pool);
+      case Reduction::PROD: return prod(body, var, lo, hi, table, pool);
+      case Reduction::INTEGRATE: return integrate(body, var, lo, hi, table, pool);
+      case Reduction::ROOT: return root(body, var, lo, hi, table);
+    }
+    throw std::logic_error("Invalid reduction");
+  }
+
+  template float reduce<float>(Reduction, const Expression&, std::string_view, float, float, SymbolTable&, ThreadPool*);
+  template double reduce<double>(Reduction, const Expression&, std::string_view, double, double, SymbolTable&, ThreadPool*);
+  template long double reduce<long double>(Reduction, const Expression&, std::string_view, long double, long double,
+                                           SymbolTable&, ThreadPool*);
+
+  template float reduce<float>(Reduction, const BasicProgram<float>&, std::string_view, float, float, const SymbolTable&, ThreadPool*);
+  template double reduce<double>(Reduction, const BasicProgram<double>&, std::string_view, double, double,
+                                 const SymbolTable&, ThreadPool*);
+  template long double reduce<long double>(Reduction, const BasicProgram<long double>&, std::string_view, long double, long double,
+                                           const SymbolTable&, ThreadPool*);
+}
@@ -0,0 +1,415 @@
+#include "snapshot.hpp"
+#include "operator.hpp"
+
+#include <algorithm>   // for std::max
+#include <cstdint>     // for std::uint8_t, std::uint32_t, std::uint64_t
+#include <cstdio>      // for std::FILE, std::fopen, std::fwrite, std::remove
+#include <cstdlib>     // for std::getenv
+#include <cstring>     // for std::memcpy, std::memcmp, std::memset
+#include <filesystem>  // for std::filesystem::rename
+#include <span>        // for std::span
+#include <stdexcept>   // for std::runtime_error
+#include <string_view> // for std::string_view
+#include <type_traits> // for std::is_trivially_copyable_v
+#include <fmt/core.h>
+
+#if defined(_WIN32)
+#include <fstream>   // for std::ifstream
+#include <iterator>  // for std::istreambuf_iterator
+#else
+#include <fcntl.h>    // for open
+#include <sys/mman.h> // for mmap, munmap
+#include <sys/stat.h> // for fstat
+#include <unistd.h>   // for close
+#endif
+
+namespace console {
+  namespace {
+    constexpr char magic[8] = {'S', 'Y', 'A', 'S', 'N', 'A', 'P', '\0'};
+    constexpr uint32_t version = 3; // bumped whenever a record changes
+    constexpr uint32_t byte_order = 0x01020304; // reads differently on a platform of the other endianness
+
+    // every offset is from the start of the file, arrays are aligned to 8 bytes
+    struct Header {
+      char magic[8];
+      uint32_t version;
+      uint32_t byte_order;
+      uint64_t size; // of the whole file
+      uint64_t symbols, symbols_offset;   // SymbolRecord array
+      uint64_t history, history_offset;   // HistoryRecord array
+      uint64_t programs, programs_offset; // ProgramRecord array
+    };
+
+    struct StringRef {
+      uint64_t offset, size;
+    };
+
+    struct SymbolRecord {
+      StringRef name;
+      double value;
+      uint8_t defined, read_only;
+    };
+
+    struct HistoryRecord {
+      uint64_t id;
+      StringRef expression;
+      double result;
+    };
+
+    struct Array {
+      uint64_t offset, count;
+    };
+
+    struct TokenRecord {
+      StringRef value;
+      sya::TokenType type;
+      uint32_t position;
+    };
+
+    struct ProgramRecord {
+      StringRef key;
+      Array tokens;   // TokenRecord
+      Array code;     // sya::Instruction
+      Array literals; // double
+      Array calls;    // sya::Function
+      Array names;    // StringRef
+      Array positions; // uint32_t, one per name
+      Array inputs, outputs; // uint8_t, one per name
+      Array symbols;  // uint64_t
+      uint64_t depth, temps;
+      uint8_t assigns;
+    };
+
+    static_assert(std::is_trivially_copyable_v<sya::Instruction>, "instructions are written as they are laid out in memory");
+
+    // a record with its padding zeroed too, so that snapshots are reproducible and don't carry stale memory
+    template <typename T>
+    T zeroed() noexcept {
+      static_assert(std::is_trivially_copyable_v<T>);
+      T record;
+      std::memset(&record, 0, sizeof(record));
+      return record;
+    }
+
+    class Writer {
+      private:
+      std::vector<char> m_data;
+
+      public:
+      Writer() { m_data.resize(sizeof(Header)); }
+
+      void align() { m_data.resize((m_data.size() + 7) & ~std::size_t{7}); }
+
+      template <typename T>
+      Array array(std::span<const T> values) {
+        align();
+        Array a{m_data.size(), values.size()};
+        m_data.resize(m_data.size() + values.size_bytes());
+        if (!values.empty()) std::memcpy(m_data.data() + a.offset, values.data(), values.size_bytes());
+        return a;
+      }
+
+      StringRef string(std::string_view text) {
+        StringRef ref{m_data.size(), text.size()};
+        m_data.insert(m_data.end(), text.begin(), text.end());
+        return ref;
+      }
+
+      [[nodiscard]] std::vector<char>& data() noexcept { return m_data; }
+    };
+
+    // every read is checked against the size of the file, so that a truncated or corrupt snapshot
+    // is rejected instead of read out of bounds
+    class Reader {
+      private:
+      std::string_view m_data;
+
+      public:
+      explicit Reader(std::string_view data) noexcept : m_data(data) {}
+
+      [[noreturn]] static void invalid() { throw std::runtime_error("Invalid snapshot: the file is truncated or corrupt"); }
+
+      template <typename T>
+      std::span<const T> array(Array a) const {
+        if (a.offset % alignof(T) != 0 || a.offset > m_data.size() || a.count > (m_data.size() - a.offset) / sizeof(T)) invalid();
+        return {reinterpret_cast<const T*>(m_data.data() + a.offset), static_cast<std::size_t>(a.count)};
+      }
+
+      std::string_view string(StringRef ref) const {
+        if (ref.offset > m_data.size() || ref.size > m_data.size() - ref.offset) invalid();
+        return m_data.substr(ref.offset, ref.size);
+      }
+    };
+
+    // rebuild a compiled expression, checking its operands so that evaluating it stays in bounds
+    sya::CompiledExpression<double> read_program(const Reader& in, const ProgramRecord& record, const sya::SymbolTable& table) {
+      sya::CompiledExpression<double> value;
+      for (const auto& token : in.array<TokenRecord>(record.tokens)) {
+        if (token.type > sya::TokenType::UNKNOWN) Reader::invalid();
+        value.rpn.push(in.string(token.value), token.type, token.position);
+      }
+
+      auto& p = value.program;
+      auto code = in.array<sya::Instruction>(record.code);
+      auto literals = in.array<double>(record.literals);
+      auto calls = in.array<sya::Function>(record.calls);
+      auto names = in.array<StringRef>(record.names);
+      auto positions = in.array<uint32_t>(record.positions);
+      auto inputs = in.array<uint8_t>(record.inputs);
+      auto outputs = in.array<uint8_t>(record.outputs);
+      auto symbols = in.array<uint64_t>(record.symbols);
+      if (inputs.size() != names.size() || outputs.size() != names.size() || positions.size() != names.size()) Reader::invalid();
+      if (!symbols.empty() && symbols.size() != names.size()) Reader::invalid(); // bound or not
+
+      p.code.assign(code.begin(), code.end());
+      p.literals.assign(literals.begin(), literals.end());
+      for (auto fn : calls) {
+        if (static_cast<std::size_t>(fn) >= sya::functions.size()) Reader::invalid();
+        p.functions.push_back(sya::resolve_function<double>(fn)); // function pointers don't survive the process
+        p.calls.push_back(fn);
+      }
+      for (const auto& name : names) p.names.emplace_back(in.string(name));
+      p.positions.assign(positions.begin(), positions.end());
+      p.inputs.assign(inputs.begin(), inputs.end());
+      p.outputs.assign(outputs.begin(), outputs.end());
+      for (auto slot : symbols) {
+        if (slot >= table.size()) Reader::invalid();
+        p.symbols.push_back(static_cast<std::size_t>(slot));
+      }
+      p.temps = record.temps;
+      p.assigns = record.assigns != 0;
+
+      const std::size_t slots = p.symbols.empty() ? p.names.size() : table.size(); // bound programs use table slots
+      std::size_t depth = 0, saves = 0; // simulated like the compiler does, the evaluators trust it
+      for (const auto& instruction : p.code) {
+        std::size_t pops = 0, pushes = 0;
+        bool valid = true;
+        switch (instruction.op) {
+          case sya::OpCode::PUSH: valid = instruction.arg < p.literals.size(); pushes = 1; break;
+          case sya::OpCode::LOAD: valid = instruction.arg < slots; pushes = 1; break;
+          case sya::OpCode::STORE: valid = instruction.arg < slots && depth > 0; break;
+          case sya::OpCode::ADD: case sya::OpCode::SUB: case sya::OpCode::MUL: case sya::OpCode::DIV: case sya::OpCode::POW:
+            pops = 2; pushes = 1; break;
+          case sya::OpCode::CALL:
+            valid = instruction.arg < p.calls.size()
+                 && instruction.arity == sya::functions[static_cast<std::size_t>(p.calls[instruction.arg])].arity;
+            pops = instruction.arity; pushes = 1; break;
+          case sya::OpCode::SAVE: valid = instruction.arg < p.temps && depth > 0; saves++; break;
+          case sya::OpCode::RECALL: valid = instruction.arg < p.temps; pushes = 1; break;
+          default: valid = false;
+        }
+        if (!valid || depth < pops) Reader::invalid();
+        depth = depth - pops + pushes;
+        p.depth = std::max(p.depth, depth); // the stack the evaluators reserve, never the recorded one
+      }
+      if (p.temps > saves) Reader::invalid(); // every temporary is saved before it's recalled
+      return value;
+    }
+
+    // the file's bytes, mapped where supported
+    class MappedFile {
+      private:
+      std::string_view m_data;
+#if defined(_WIN32)
+      std::string m_content;
+#endif
+
+      public:
+      explicit MappedFile(const std::string& path) {
+#if defined(_WIN32)
+        std::ifstream file(path, std::ios::binary);
+        if (!file) throw std::runtime_error(fmt::format("Cannot open file: '{}'", path));
+        m_content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        m_data = m_content;
+#else
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error(fmt::format("Cannot open file: '{}'", path));
+
+        struct stat info{};
+        if (::fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+          ::close(fd);
+          throw std::runtime_error(fmt::format("Cannot read file: '{}'", path));
+        }
+
+        const auto size = static_cast<std::size_t>(info.st_size);
+        if (size != 0) {
+          void* data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+          if (data == MAP_FAILED) {
+            ::close(fd);
+            throw std::runtime_error(fmt::format("Cannot map file: '{}'", path));
+          }
+          m_data = {static_cast<const char*>(data), size};
+        }
+        ::close(fd);
+#endif
+      }
+      MappedFile(const MappedFile&) = delete;
+      MappedFile& operator=(const MappedFile&) = delete;
+      ~MappedFile() {
+#if !defined(_WIN32)
+        if (!m_data.empty()) ::munmap(const_cast<char*>(m_data.data()), m_data.size());
+#endif
+      }
+
+      [[nodiscard]] std::string_view data() const noexcept { return m_data; }
+    };
+  }
+
+  SnapshotSummary save_snapshot(const std::string& path, const sya::SymbolTable& table,
+                                const HistoryStore& history, const sya::BasicExpressionCache<double>& cache) {
+    SnapshotSummary summary;
+    Writer out;
+
+    // records are gathered first and written as arrays after their strings
+    std::vector<SymbolRecord> symbols;
+    symbols.reserve(table.size());
+    for (std::size_t slot = 0; slot < table.size(); slot++) {
+      auto& record = symbols.emplace_back(zeroed<SymbolRecord>());
+      record.name = out.string(table.name(slot));
+      record.value = table.value(slot);
+      record.defined = table.defined(slot);
+      record.read_only = table.read_only(slot);
+      if (table.defined(slot) && !table.read_only(slot)) summary.variables++;
+    }
+
+    std::vector<HistoryRecord> entries;
+    entries.reserve(history.size());
+    for (std::size_t i = 0; i < history.size(); i++) {
+      const HistoryEntry entry = history[i];
+      auto& record = entries.emplace_back(zeroed<HistoryRecord>());
+      record.id = entry.id;
+      record.expression = out.string(entry.expression);
+      record.result = entry.result;
+    }
+    summary.history = entries.size();
+
+    std::vector<ProgramRecord> programs;
+    for (const auto& [key, value] : cache.entries()) { // least recently used first, as they are inserted back
+      const auto& p = value->program;
+      auto record = zeroed<ProgramRecord>();
+      record.key = out.string(key);
+
+      std::vector<TokenRecord> tokens;
+      for (const auto& token : value->rpn) {
+        auto& t = tokens.emplace_back(zeroed<TokenRecord>());
+        t.value = out.string(token.view());
+        t.type = token.type();
+        t.position = token.position();
+      }
+      std::vector<sya::Instruction> code;
+      for (const auto& in : p.code) {
+        auto& c = code.emplace_back(zeroed<sya::Instruction>());
+        c.op = in.op;
+        c.arity = in.arity;
+        c.arg = in.arg;
+      }
+      std::vector<StringRef> names;
+      for (const auto& name : p.names) names.push_back(out.string(name));
+      std::vector<uint8_t> inputs(p.inputs.begin(), p.inputs.end()), outputs(p.outputs.begin(), p.outputs.end());
+      std::vector<uint64_t> slots(p.symbols.begin(), p.symbols.end());
+
+      record.tokens = out.array<TokenRecord>(tokens);
+      record.code = out.array<sya::Instruction>(code);
+      record.literals = out.array<double>(p.literals);
+      record.calls = out.array<sya::Function>(p.calls);
+      record.names = out.array<StringRef>(names);
+      record.positions = out.array<uint32_t>(p.positions);
+      record.inputs = out.array<uint8_t>(inputs);
+      record.outputs = out.array<uint8_t>(outputs);
+      record.symbols = out.array<uint64_t>(slots);
+      record.depth = p.depth;
+      record.temps = p.temps;
+      record.assigns = p.assigns;
+      programs.push_back(record);
+    }
+    summary.programs = programs.size();
+
+    auto header = zeroed<Header>();
+    std::memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.byte_order = byte_order;
+    header.symbols = symbols.size();
+    header.symbols_offset = out.array<SymbolRecord>(symbols).offset;
+    header.history = entries.size();
+    header.history_offset = out.array<HistoryRecord>(entries).offset;
+    header.programs = programs.size();
+    header.programs_offset = out.array<ProgramRecord>(programs).offset;
+    header.size = out.data().size();
+    std::memcpy(out.data().data(), &header, sizeof(header));
+
+    // a crash while writing leaves the previous snapshot intact
+    const std::string temporary = path + ".tmp";
+    std::FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (!file) throw std::runtime_error(fmt::format("Cannot open file: '{}'", temporary));
+    const bool written = std::fwrite(out.data().data(), 1, out.data().size(), file) == out.data().size();
+    if (std::fclose(file) != 0 || !written) {
+      std::remove(temporary.c_str());
+      throw std::runtime_error(fmt::format("Cannot write file: '{}'", temporary));
+    }
+    std::error_code error; // replaces the previous snapshot atomically, with MoveFileExW(MOVEFILE_REPLACE_EXISTING) on Windows
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+      std::remove(temporary.c_str());
+      throw std::runtime_error(fmt::format("Cannot write file: '{}'", path));
+    }
+    return summary;
+  }
+
+  SnapshotSummary load_snapshot(const std::string& path, sya::SymbolTable& table,
+                                HistoryStore& history, sya::BasicExpressionCache<double>& cache) {
+    const MappedFile file(path);
+    const std::string_view data = file.data();
+    const Reader in(data);
+
+    Header header;
+    if (data.size() < sizeof(header)) Reader::invalid();
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (std::memcmp(header.magic, magic, sizeof(magic)) != 0) throw std::runtime_error(fmt::format("Not a snapshot: '{}'", path));
+    if (header.version != version || header.byte_order != byte_order)
+      throw std::runtime_error(fmt::format("Unsupported snapshot: '{}' was written by another version or platform", path));
+    if (header.size != data.size()) Reader::invalid();
+
+    auto symbols = in.array<SymbolRecord>({header.symbols_offset, header.symbols});
+    auto entries = in.array<HistoryRecord>({header.history_offset, header.history});
+    auto programs = in.array<ProgramRecord>({header.programs_offset, header.programs});
+
+    // everything is rebuilt aside, the session is only replaced once the whole snapshot is read
+    SnapshotSummary summary;
+    sya::SymbolTable restored; // seeded with the constants, like the saved table was
+    restored.reserve(symbols.size());
+    for (std::size_t slot = 0; slot < symbols.size(); slot++) {
+      const auto& record = symbols[slot];
+      if (restored.intern(in.string(record.name)) != slot) Reader::invalid(); // programs are bound to these slots
+      if (!record.defined || restored.read_only(slot)) continue;
+
+      restored.assign(slot, record.value);
+      summary.variables++;
+    }
+
+    HistoryStore restored_history(history.limit());
+    for (const auto& record : entries)
+      restored_history.add(static_cast<std::size_t>(record.id), in.string(record.expression), record.result);
+    summary.history = restored_history.size();
+
+    std::vector<std::pair<std::string_view, sya::CompiledExpression<double>>> compiled;
+    compiled.reserve(programs.size());
+    for (const auto& record : programs) compiled.emplace_back(in.string(record.key), read_program(in, record, restored));
+    summary.programs = compiled.size();
+
+    table = std::move(restored);
+    history = std::move(restored_history);
+    cache.clear();
+    for (auto& [key, value] : compiled) cache.insert(key, std::move(value), table);
+    return summary;
+  }
+
+  [[nodiscard]] std::string default_session_path() {
+    if (const char* path = std::getenv("CALCULATOR_SESSION")) return path;
+#if defined(_WIN32)
+    const char* home = std::getenv("USERPROFILE");
+#else
+    const char* home = std::getenv("HOME");
+#endif
+    return home ? fmt::format("{}/.calculator_session", home) : std::string();
+  }
+}
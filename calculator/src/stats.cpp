@@ -0,0 +1,88 @@
+#include "stats.hpp"
+
+#include <algorithm> // for std::min, std::max
+#include <bit>       // for std::bit_width
+
+namespace sya {
+  [[nodiscard]] std::uint64_t Histogram::percentile(double p) const noexcept {
+    if (count == 0) return 0;
+
+    const auto rank = static_cast<std::uint64_t>(p * static_cast<double>(count - 1)) + 1; // 1-based rank of the percentile
+    std::uint64_t seen = 0;
+    for (std::size_t b = 0; b < buckets; b++) {
+      seen += counts[b];
+      if (seen >= rank) return std::min(std::uint64_t(1) << b, max);
+    }
+    return max;
+  }
+
+  namespace {
+    // only the owning thread writes a shard, a load and a store are enough and don't lock the bus
+    void add(std::atomic<std::uint64_t>& counter, std::uint64_t n) noexcept {
+      counter.store(counter.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+  }
+
+  [[nodiscard]] Stats::Shard& Stats::local() noexcept {
+    thread_local Shard* shard = nullptr; // there is one Stats, so one shard per thread
+    if (!shard) {
+      const std::lock_guard lock(m_mutex);
+      shard = m_shards.emplace_back(std::make_unique<Shard>()).get();
+    }
+    return *shard;
+  }
+
+  void Stats::record(Phase phase, std::uint64_t ns) noexcept {
+    auto& h = local().phases[static_cast<std::size_t>(phase)];
+    const std::size_t bucket = std::min<std::size_t>(std::bit_width(ns), Histogram::buckets - 1);
+
+    add(h.count, 1);
+    add(h.total, ns);
+    add(h.counts[bucket], 1);
+    if (ns > h.max.load(std::memory_order_relaxed)) h.max.store(ns, std::memory_order_relaxed);
+  }
+
+  void Stats::call(Function fn) noexcept { add(local().calls[static_cast<std::size_t>(fn)], 1); }
+  void Stats::count(Counter counter) noexcept { add(local().counters[static_cast<std::size_t>(counter)], 1); }
+
+  [[nodiscard]] StatsSnapshot Stats::total() const noexcept {
+    StatsSnapshot s;
+    for (const auto& shard : m_shards) {
+      for (std::size_t p = 0; p < shard->phases.size(); p++) {
+        const auto& h = shard->phases[p];
+        s.phases[p].count += h.count.load(std::memory_order_relaxed);
+        s.phases[p].total += h.total.load(std::memory_order_relaxed);
+        s.phases[p].max = std::max(s.phases[p].max, h.max.load(std::memory_order_relaxed));
+        for (std::size_t b = 0; b < Histogram::buckets; b++) s.phases[p].counts[b] += h.counts[b].load(std::memory_order_relaxed);
+      }
+      for (std::size_t f = 0; f < s.calls.size(); f++) s.calls[f] += shard->calls[f].load(std::memory_order_relaxed);
+      for (std::size_t c = 0; c < s.counters.size(); c++) s.counters[c] += shard->counters[c].load(std::memory_order_relaxed);
+    }
+    return s;
+  }
+
+  [[nodiscard]] StatsSnapshot Stats::snapshot() const noexcept {
+    const std::lock_guard lock(m_mutex);
+    StatsSnapshot s = total();
+    for (std::size_t p = 0; p < s.phases.size(); p++) { // counts since the last reset
+      s.phases[p].count -= m_baseline.phases[p].count;
+      s.phases[p].total -= m_baseline.phases[p].total;
+      for (std::size_t b = 0; b < Histogram::buckets; b++) s.phases[p].counts[b] -= m_baseline.phases[p].counts[b];
+    }
+    for (std::size_t f = 0; f < s.calls.size(); f++) s.calls[f] -= m_baseline.calls[f];
+    for (std::size_t c = 0; c < s.counters.size(); c++) s.counters[c] -= m_baseline.counters[c];
+    return s;
+  }
+
+  void Stats::reset() noexcept {
+    const std::lock_guard lock(m_mutex);
+    m_baseline = total();
+    for (auto& shard : m_shards) // a maximum can't be subtracted, it restarts from zero
+      for (auto& h : shard->phases) h.max.store(0, std::memory_order_relaxed);
+  }
+
+  [[nodiscard]] Stats& stats() noexcept {
+    static Stats instance;
+    return instance;
+  }
+}
@@ -0,0 +1,68 @@
+#include "symbols.hpp"
+#include "stats.hpp"
+
+#include <stdexcept> // for std::logic_error
+#include <fmt/core.h>
+
+namespace sya {
+  SymbolTable::SymbolTable() {
+    for (const auto& [name, value] : constants) {
+      auto slot = intern(name);
+      m_values[slot] = value;
+      m_flags[slot] = DEFINED | READ_ONLY;
+    }
+  }
+
+  void SymbolTable::reserve(std::size_t slots) {
+    m_values.reserve(slots);
+    m_flags.reserve(slots);
+    m_index.reserve(slots);
+  }
+
+  std::size_t SymbolTable::intern(std::string_view name) {
+    SYA_STATS_COUNT(VARIABLE_LOOKUPS);
+    if (auto it = m_index.find(name); it != m_index.end()) return it->second;
+
+    const std::string& stored = m_names.emplace_back(name);
+    m_values.push_back(0);
+    m_flags.push_back(0);
+    m_index.emplace(stored, m_values.size() - 1);
+    return m_values.size() - 1;
+  }
+
+  [[nodiscard]] std::size_t SymbolTable::find(std::string_view name) const noexcept {
+    SYA_STATS_COUNT(VARIABLE_LOOKUPS);
+    auto it = m_index.find(name);
+    return it != m_index.end() ? it->second : npos;
+  }
+
+  void SymbolTable::assign(std::size_t slot, double value) {
+    if (read_only(slot))
+      throw std::logic_error(fmt::format("Cannot assign to reserved constant '{}'", m_names[slot]));
+    m_values[slot] = value;
+    m_flags[slot] |= DEFINED;
+  }
+
+  std::size_t SymbolTable::set(std::string_view name, double value) {
+    auto slot = intern(name);
+    assign(slot, value);
+    return slot;
+  }
+
+  bool SymbolTable::remove(std::string_view name) noexcept {
+    auto slot = find(name);
+    if (slot == npos || !defined(slot) || read_only(slot)) return false;
+
+    m_flags[slot] &= ~DEFINED; // the slot stays, programs bound to it keep working
+    m_values[slot] = 0;
+    return true;
+  }
+
+  void SymbolTable::clear() noexcept {
+    for (std::size_t slot = 0; slot < size(); slot++) {
+      if (read_only(slot)) continue;
+      m_flags[slot] &= ~DEFINED;
+      m_values[slot] = 0;
+    }
+  }
+}
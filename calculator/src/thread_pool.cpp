@@ -0,0 +1,96 @@
+#include "thread_pool.hpp"
+
+#include <algorithm> // for std::max
+#include <utility>   // for std::exchange
+
+namespace sya {
+  ThreadPool::ThreadPool(std::size_t threads) {
+    if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (std::size_t i = 0; i < threads; i++) m_queues.push_back(std::make_unique<Queue>());
+    for (std::size_t i = 0; i < threads; i++) m_threads.emplace_back([this, i] { work(i); });
+  }
+
+  ThreadPool::~ThreadPool() {
+    {
+      std::lock_guard lock(m_mutex);
+      m_stop = true;
+    }
+    m_wake.notify_all();
+    for (auto& thread : m_threads) thread.join();
+  }
+
+  void ThreadPool::submit(Task task) {
+    std::size_t queue;
+    {
+      std::lock_guard lock(m_mutex); // counted before it's visible, so that taking it never underflows
+      m_queued++;
+      m_pending++;
+      queue = m_next++ % m_queues.size();
+    }
+    {
+      std::lock_guard lock(m_queues[queue]->mutex);
+      m_queues[queue]->tasks.push_back(std::move(task));
+    }
+    m_wake.notify_one();
+  }
+
+  void ThreadPool::wait() {
+    std::unique_lock lock(m_mutex);
+    m_idle.wait(lock, [this] { return m_pending == 0; });
+
+    if (m_error) {
+      auto error = std::exchange(m_error, nullptr);
+      std::rethrow_exception(error);
+    }
+  }
+
+  bool ThreadPool::take(std::size_t worker, Task& task) {
+    bool taken = false;
+    {
+      Queue& own = *m_queues[worker];
+      std::lock_guard lock(own.mutex);
+      if (!own.tasks.empty()) {
+        task = std::move(own.tasks.back());
+        own.tasks.pop_back();
+        taken = true;
+      }
+    }
+
+    for (std::size_t k = 1; !taken && k < m_queues.size(); k++) { // steal, starting from the next worker
+      Queue& other = *m_queues[(worker + k) % m_queues.size()];
+      std::lock_guard lock(other.mutex);
+      if (!other.tasks.empty()) {
+        task = std::move(other.tasks.front());
+        other.tasks.pop_front();
+        taken = true;
+      }
+    }
+
+    if (taken) {
+      std::lock_guard lock(m_mutex);
+      m_queued--;
+    }
+    return taken;
+  }
+
+  void ThreadPool::work(std::size_t worker) {
+    while (true) {
+      Task task;
+      if (take(worker, task)) {
+        std::exception_ptr error;
+        try { task(worker); }
+        catch (...) { error = std::current_exception(); }
+
+        std::lock_guard lock(m_mutex);
+        if (error && !m_error) m_error = error;
+        if (--m_pending == 0) m_idle.notify_all();
+        continue;
+      }
+
+      std::unique_lock lock(m_mutex);
+      m_wake.wait(lock, [this] { return m_stop || m_queued != 0; });
+      if (m_stop && m_queued == 0) return;
+    }
+  }
+}
@@ -9,8 +9,8 @@ namespace sya {
   |      CONSTRUCTORS      |
   \************************/
   // Token::Token(std::string_view value) : ItClasses(m_value), m_value(value), m_type(TokenType::UNKNOWN) {}
-  Token::Token(std::string_view value, TokenType type) noexcept
-  : m_value(value), m_type(type) {} // main ctor
+  Token::Token(std::string_view value, TokenType type, uint32_t position) noexcept
+  : m_value(value), m_type(type), m_position(position) {} // main ctor
 
   /************************\
   |        OPERATORS       |
@@ -22,7 +22,6 @@ namespace sya {
   /************************\
   |         METHODS        |
   \************************/
-  [[nodiscard]] constexpr std::string_view Token::view() const noexcept { return m_value; }
   void Token::append(std::string_view value) { m_value.append(value); }
   bool Token::is_empty() const noexcept { return m_value.empty(); } // if token is empty
   [[nodiscard]] std::string Token::get() const noexcept { return m_value; }         // get token's vaue
@@ -33,6 +32,7 @@ namespace sya {
   void Token::swap(Token& t) noexcept {
     std::swap(m_value, t.m_value);   // swap values
     std::swap(m_type, t.m_type); // swap types
+    std::swap(m_position, t.m_position); // and positions
   }
   void swap(Token& t1, Token& t2) noexcept { t1.swap(t2); } // an outer func to swap current token's contents with another
 